@@ -92,6 +92,7 @@ fn_benchmark_res_t bench_basic(test_config_t *config) {
 
 void print_results(fn_benchmark_res_t *results, uint32_t n) {
     printf("----BENCHMARK RESULTS----\n\n");
+    printf("\tKernel tier: %s\n\n", bi_kernel_tier());
 
     for (uint32_t i = 0; i < n; i++) {
         fn_benchmark_res_t res = results[i];
@@ -5,9 +5,33 @@
 #include <stdint.h>
 #include <stdio.h>
 
+/*
+ * Limb type. Words are 32 bits by default, with 64 bit intermediate products.
+ * Building with BIGINT_64BIT_LIMBS (the CMake option of the same name) makes
+ * them 64 bits, with unsigned __int128 intermediates, which halves the word
+ * count and quarters the inner loop iterations of the multiply kernels.
+ */
+#ifdef BIGINT_64BIT_LIMBS
+typedef uint64_t bi_word_t;
+__extension__ typedef unsigned __int128 bi_dword_t;
+#define BI_WORD_BITS 64
+#else
+typedef uint32_t bi_word_t;
+typedef uint64_t bi_dword_t;
+#define BI_WORD_BITS 32
+#endif
+
+/*
+ * Values of up to this many words are stored inside the struct itself, so
+ * small bigints only cost the one allocation for the struct.
+ */
+#define BI_INLINE_WORDS 4
+
 struct bigint {
-    uint32_t words;
-    uint32_t *data;
+    uint32_t words;    // length of the value
+    uint32_t capacity; // words allocated at data
+    bi_word_t *data;   // either inline_data or a heap buffer
+    bi_word_t inline_data[BI_INLINE_WORDS];
 };
 
 typedef struct bigint *MPI;
@@ -30,6 +54,22 @@ MPI bi_init_like(MPI like);
  */
 void bi_free(MPI x);
 
+/*
+ * Temporaries inside the bigint operations come from a per thread scratch
+ * arena, which keeps the largest size it has needed so that later calls
+ * don't go back to the heap. Long lived threads can call this to give that
+ * memory back once they're done with bigint work.
+ */
+void bi_scratch_free(void);
+
+/*
+ * Name of the CPU tier the kernels were picked for: generic, adx, avx2 or
+ * ifma. It's probed when the library loads, and setting the BIGINT_CPU
+ * environment variable to one of those names caps it, e.g. to benchmark the
+ * generic kernels on a machine that has faster ones.
+ */
+const char *bi_kernel_tier(void);
+
 /*
  * Copies the data from src into trgt. Assumes trgt's memory is already
  * initialised - if it isn't, use bi_init_and_copy instead
@@ -55,7 +95,7 @@ void bi_set(MPI x, uint32_t val);
 MPI bi_add(MPI a, MPI b);
 
 // a += b
-void add_in_place(MPI a, MPI b);
+void bi_add_in_place(MPI a, MPI b);
 
 MPI bi_sub(MPI a, MPI b);
 
@@ -63,10 +103,36 @@ MPI bi_sub(MPI a, MPI b);
 void bi_sub_in_place(MPI a, MPI b);
 
 MPI bi_mul(MPI a, MPI b);
+
+// a * a, computing each cross product once
+MPI bi_sqr(MPI a);
+
 MPI bi_mul_imm(MPI a, uint32_t x);
 void bi_inc(MPI x);
 void bi_dec(MPI x);
 MPI bi_mod_exp(MPI x, MPI exp, MPI mod);
+
+/*
+ * The product of a[i]^b[i] mod n for i < count, such as g^x * h^y in a
+ * signature check. The exponentiations share their squarings, so two of them
+ * cost little more than one bi_mod_exp of the longer exponent.
+ */
+MPI bi_mod_multi_exp(MPI *a, MPI *b, uint32_t count, MPI n);
+
+/*
+ * out[i] = a[i]^b[i] mod n for i < count, or a[i]^e mod n for every i when b
+ * is NULL. The reduction context for n is set up once and shared by up to
+ * threads threads, the caller's included, with 0 meaning one per online CPU.
+ * out holds count initialised bigints, and out[i] may be a[i] or b[i].
+ */
+void bi_mod_exp_batch(MPI *out, MPI *a, MPI *b, MPI e, uint32_t count, MPI n,
+                      uint32_t threads);
+
+/*
+ * a^-1 mod b. The running time depends only on the word lengths of a and b
+ * and on which of them are even, so it's safe for private exponents and
+ * blinding factors. Exits if a and b aren't coprime.
+ */
 MPI bi_mod_mult_inv(MPI a, MPI b);
 MPI bi_pow_imm(MPI b, uint32_t p);
 
@@ -76,6 +142,22 @@ MPI bi_pow_imm(MPI b, uint32_t p);
 void bi_eucl_div(MPI a, MPI b, MPI *q, MPI *r);
 void bi_eucl_div_imm(MPI a, uint32_t b, MPI *q, MPI *r);
 
+/*
+ * Destination-passing versions of the above, which write the result into an
+ * existing bigint instead of returning a new one. The storage of the
+ * destination is reused and only grows when the result needs more words, and
+ * the destination may be one of the inputs, e.g. bi_add_into(a, a, b).
+ */
+void bi_add_into(MPI dst, MPI a, MPI b);
+void bi_sub_into(MPI dst, MPI a, MPI b);
+void bi_mul_into(MPI dst, MPI a, MPI b);
+void bi_sqr_into(MPI dst, MPI a);
+void bi_shift_left_into(MPI dst, MPI a, uint32_t n);
+void bi_shift_right_into(MPI dst, MPI a, uint32_t n);
+
+// q = u / v and r = u % v, either of which may be NULL
+void bi_eucl_div_into(MPI q, MPI r, MPI u, MPI v);
+
 bool bi_eq(MPI a, MPI b);
 bool bi_eq_val(MPI a, uint32_t b);
 bool bi_gt(MPI a, MPI b);
@@ -84,6 +166,12 @@ bool bi_lt(MPI a, MPI b);
 bool bi_le(MPI a, MPI b);
 bool bi_even(MPI a);
 
+// number of significant bits in a, 0 for a = 0
+uint32_t bi_bit_length(MPI a);
+
+// value of bit i of a, where bit 0 is the least significant
+bool bi_test_bit(MPI a, uint32_t i);
+
 // Logical expressions
 MPI bi_and(MPI a, MPI b);
 MPI bi_or(MPI a, MPI b);
@@ -91,6 +179,14 @@ MPI bi_xor(MPI a, MPI b);
 MPI bi_not(MPI a);
 MPI bi_shift_left(MPI a, uint32_t n);
 MPI bi_shift_right(MPI a, uint32_t n);
+
+// a <<= n and a >>= n, in a's own storage
+void bi_shift_left_in_place(MPI a, uint32_t n);
+void bi_shift_right_in_place(MPI a, uint32_t n);
+
+// Shifts a right past its trailing zero bits, leaving it odd, and returns how
+// many there were. 0 is left as it is.
+uint32_t bi_strip_trailing_zeros(MPI a);
 void bi_print(MPI x);
 void bi_printf(MPI x, FILE *fp);
 
@@ -114,6 +210,129 @@ MPI bi_gcd(MPI a, MPI b);
 
 MPI from_hex_str(char *str);
 
+// ------ DIVISION -----
+
+/*
+ * A divisor prepared for dividing by over and over. It's shifted so its top
+ * bit is set and the reciprocal of its top two words is worked out once, so
+ * each division skips straight to the quotient loop, which costs one
+ * multiplication per quotient word on top of the row update rather than a
+ * hardware divide. Large operands go by recursive division instead.
+ */
+typedef struct {
+    MPI d;           // the divisor shifted left by shift bits, k words
+    uint32_t shift;  // leading zero bits of the divisor's top word
+    bi_word_t d_inv; // reciprocal of d's top two words, when k > 1
+} bi_div_ctx_t;
+
+void bi_div_init(bi_div_ctx_t *ctx, MPI d);
+void bi_div_free(bi_div_ctx_t *ctx);
+
+// q = u / d and r = u % d. Either may be NULL, and either may be u.
+void bi_div_qr_into(MPI q, MPI r, MPI u, bi_div_ctx_t *ctx);
+
+// u % d, without storing the quotient
+MPI bi_div_mod(MPI u, bi_div_ctx_t *ctx);
+void bi_div_mod_into(MPI r, MPI u, bi_div_ctx_t *ctx);
+
+// ------ MONTGOMERY -----
+
+/*
+ * Precomputed values for Montgomery multiplication modulo an odd n, with
+ * R = 2^(BI_WORD_BITS * n->words). Build once with bi_mont_init and reuse for
+ * every product mod n.
+ */
+typedef struct {
+    MPI n;           // squeezed copy of the modulus
+    MPI r2;          // R^2 mod n
+    bi_word_t n_inv; // -n^-1 mod 2^BI_WORD_BITS
+} bi_mont_ctx_t;
+
+void bi_mont_init(bi_mont_ctx_t *ctx, MPI n);
+void bi_mont_free(bi_mont_ctx_t *ctx);
+
+// x * R mod n
+MPI bi_to_mont(MPI x, bi_mont_ctx_t *ctx);
+
+// x * R^-1 mod n
+MPI bi_from_mont(MPI x, bi_mont_ctx_t *ctx);
+
+// a * b * R^-1 mod n, for a, b < n
+MPI bi_mont_mul(MPI a, MPI b, bi_mont_ctx_t *ctx);
+
+// a * a * R^-1 mod n, for a < n
+MPI bi_mont_sqr(MPI a, bi_mont_ctx_t *ctx);
+
+// As above, but into an existing bigint. dst may be one of the inputs.
+void bi_mont_mul_into(MPI dst, MPI a, MPI b, bi_mont_ctx_t *ctx);
+void bi_mont_sqr_into(MPI dst, MPI a, bi_mont_ctx_t *ctx);
+
+// a^e * R^(1 - e) mod n, for a < n. This is a^e in Montgomery form when a is
+// in Montgomery form, so a run of products can stay in it. dst may be a or e.
+MPI bi_mont_exp(MPI a, MPI e, bi_mont_ctx_t *ctx);
+void bi_mont_exp_into(MPI dst, MPI a, MPI e, bi_mont_ctx_t *ctx);
+
+/*
+ * a^b mod n for odd n, in constant time for secret exponents. The sequence of
+ * operations and memory accesses depends only on the word lengths of b and n,
+ * not on their values, so leading zero words of b still cost time. Use this
+ * instead of bi_mod_exp whenever b is a private key.
+ */
+MPI bi_mod_exp_ct(MPI a, MPI b, MPI n);
+
+/*
+ * A base that's raised to many exponents modulo the same odd n, such as a
+ * Diffie-Hellman generator or a fixed Miller-Rabin witness. Init precomputes
+ * Lim-Lee comb tables of the base's powers in Montgomery form, after which an
+ * exponent of up to max_bits bits costs about max_bits / (2 * teeth)
+ * squarings and max_bits / teeth multiplications, against max_bits squarings
+ * for bi_mod_exp. The tables take 2^(teeth + 1) residues. Longer exponents
+ * fall back to bi_mod_exp. Not constant time: exponents pick table entries.
+ */
+typedef struct {
+    bi_mont_ctx_t mont;
+    void *ifma;        // the AVX-512 IFMA kernels' context, when they cover n
+    MPI base;          // the base mod n
+    MPI table;         // the comb tables, one residue per entry
+    uint32_t max_bits; // longest exponent the tables cover
+    uint32_t teeth;    // exponent bits that index each table entry
+    uint32_t spacing;  // distance between those bits
+} bi_fixed_base_t;
+
+void bi_fixed_base_init(bi_fixed_base_t *fb, MPI base, MPI n,
+                        uint32_t max_bits);
+void bi_fixed_base_free(bi_fixed_base_t *fb);
+
+// base^e mod n. dst may be e.
+MPI bi_fixed_base_exp(MPI e, bi_fixed_base_t *fb);
+void bi_fixed_base_exp_into(MPI dst, MPI e, bi_fixed_base_t *fb);
+
+// ------ BARRETT -----
+
+/*
+ * Precomputed values for Barrett reduction modulo any n > 0. Unlike
+ * Montgomery this works for even moduli and needs no conversion in and out,
+ * so it suits moduli that are only used for a handful of products. Reducing
+ * is two multiplications and a subtraction instead of a long division.
+ */
+typedef struct {
+    MPI n;  // squeezed copy of the modulus, k words
+    MPI mu; // floor(2^(2 * BI_WORD_BITS * k) / n)
+} bi_barrett_ctx_t;
+
+void bi_barrett_init(bi_barrett_ctx_t *ctx, MPI n);
+void bi_barrett_free(bi_barrett_ctx_t *ctx);
+
+// x mod n. Falls back to a division when x has more than 2k words.
+MPI bi_barrett_mod(MPI x, bi_barrett_ctx_t *ctx);
+void bi_barrett_mod_into(MPI dst, MPI x, bi_barrett_ctx_t *ctx);
+
+// a * b mod n and a * a mod n, for a, b < n. dst may be one of the inputs.
+MPI bi_mod_mul(MPI a, MPI b, bi_barrett_ctx_t *ctx);
+MPI bi_mod_sqr(MPI a, bi_barrett_ctx_t *ctx);
+void bi_mod_mul_into(MPI dst, MPI a, MPI b, bi_barrett_ctx_t *ctx);
+void bi_mod_sqr_into(MPI dst, MPI a, bi_barrett_ctx_t *ctx);
+
 // ------ SIGNED OPs -----
 typedef struct {
     MPI val;
@@ -143,6 +362,11 @@ sMPI signed_add(sMPI a, sMPI b);
 void signed_eucl_div(sMPI a, sMPI b, sMPI *q, MPI *r);
 sMPI signed_mul(sMPI a, sMPI b);
 sMPI signed_sub(sMPI a, sMPI b);
+
+// *dst = a op b, reusing the storage of dst->val. dst may point at a or b.
+void signed_add_into(sMPI *dst, sMPI a, sMPI b);
+void signed_sub_into(sMPI *dst, sMPI a, sMPI b);
+void signed_mul_into(sMPI *dst, sMPI a, sMPI b);
 ext_euc_res_t ext_euc(MPI a, MPI b);
 void signed_inc(sMPI *a);
 void signed_dec(sMPI *a);
@@ -11,6 +11,9 @@ struct mr_sd {
 
 struct mr_sd miller_rabin_sd(MPI n);
 
+// A random Miller Rabin witness for odd n > 3, between 2 and n - 2
+MPI miller_rabin_randn(MPI n);
+
 bool __miller_rabin_inner_check(MPI n, MPI a, struct mr_sd sd);
 
 /*
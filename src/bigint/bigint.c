@@ -5,28 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
-typedef enum {
-    BI_OK,
-    BI_MEM_ERR,
-    BI_DIV_ZERO,
-    BI_BAD_OPERANDS,
-} __bi_result_code_t;
-
-typedef struct {
-    MPI x;
-    __bi_result_code_t code;
-} __bi_result_t;
-
-static inline __bi_result_t bi_result_make(MPI x, __bi_result_code_t code) {
-    __bi_result_t res = {x, code};
-    return res;
-}
+#include "bigint_internal.h"
 
-static inline __bi_result_t bi_result_error(__bi_result_code_t code) {
-    return bi_result_make(NULL, code);
-}
-
-__bi_result_code_t __bi_eucl_div_imm(MPI a, uint32_t b, MPI *q, MPI *r);
+__bi_result_code_t __bi_eucl_div_imm(MPI a, bi_word_t b, MPI *q, MPI *r);
 
 int assert_same_shape(MPI a, MPI b) { return a->words == b->words; }
 
@@ -59,14 +40,18 @@ __bi_result_t __bi_init(uint32_t words) {
     }
 
     x->words = words;
-    x->data = NULL;
+    x->capacity = BI_INLINE_WORDS;
+    x->data = x->inline_data;
 
-    if (words > 0) {
-        x->data = calloc((size_t)words, sizeof(uint32_t));
+    if (words <= BI_INLINE_WORDS) {
+        memset(x->inline_data, 0, sizeof(x->inline_data));
+    } else {
+        x->data = calloc((size_t)words, sizeof(bi_word_t));
         if (x->data == NULL) {
             free(x);
             return bi_result_error(BI_MEM_ERR);
         }
+        x->capacity = words;
     }
 
     return bi_result_make(x, BI_OK);
@@ -88,19 +73,14 @@ __bi_result_code_t __bi_copy(MPI src, MPI target) {
         return BI_OK;
     }
 
-    uint32_t *new_data = NULL;
-
-    if (src->words > 0) {
-        size_t bytes = (size_t)src->words * sizeof(uint32_t);
-        new_data = malloc(bytes);
-        if (new_data == NULL) {
-            return BI_MEM_ERR;
-        }
-        memcpy(new_data, src->data, bytes);
+    // nothing in target needs keeping, so drop its words before growing
+    target->words = 0;
+    __bi_result_code_t code = __bi_reserve(target, src->words);
+    if (code != BI_OK) {
+        return code;
     }
 
-    free(target->data);
-    target->data = new_data;
+    memcpy(target->data, src->data, (size_t)src->words * sizeof(bi_word_t));
     target->words = src->words;
 
     return BI_OK;
@@ -115,240 +95,109 @@ void bi_copy(MPI src, MPI target) {
 }
 
 void bi_free(MPI x) {
-    free(x->data);
+    __bi_free_data(x);
     free(x);
 }
 
-__bi_result_code_t __bi_set(MPI a, uint32_t val) {
-    uint32_t *data = realloc(a->data, sizeof(uint32_t));
+__bi_result_code_t __bi_reserve(MPI x, uint32_t words) {
+    if (words <= x->capacity) {
+        return BI_OK;
+    }
+
+    // grow geometrically, so repeated growth is amortised O(1) per word
+    uint32_t capacity = x->capacity * 2 > words ? x->capacity * 2 : words;
+    bi_word_t *data;
+    if (__bi_is_inline(x)) {
+        data = malloc((size_t)capacity * sizeof(bi_word_t));
+        if (data != NULL) {
+            memcpy(data, x->data, (size_t)x->words * sizeof(bi_word_t));
+        }
+    } else {
+        data = realloc(x->data, (size_t)capacity * sizeof(bi_word_t));
+    }
 
     if (data == NULL) {
         return BI_MEM_ERR;
     }
 
-    a->data = data;
-    a->data[0] = val;
-    a->words = 1;
+    x->data = data;
+    x->capacity = capacity;
 
     return BI_OK;
 }
 
-void bi_set(MPI a, uint32_t val) {
-    free(a->data);
-    a->data = malloc(sizeof(uint32_t));
+void __bi_resize(MPI x, uint32_t words) {
+    if (words > x->words) {
+        if (__bi_reserve(x, words) != BI_OK) {
+            fprintf(stderr, "FATAL: out of memory resizing bigint\n");
+            exit(1);
+        }
+
+        memset(x->data + x->words, 0,
+               (size_t)(words - x->words) * sizeof(bi_word_t));
+    }
+
+    x->words = words;
+}
+
+__bi_result_code_t __bi_set(MPI a, uint32_t val) {
     a->data[0] = val;
     a->words = 1;
+
+    return BI_OK;
 }
 
+void bi_set(MPI a, uint32_t val) { __bi_set(a, val); }
+
 MPI bi_add(MPI a, MPI b) {
 
     bi_squeeze(a);
     bi_squeeze(b);
 
     MPI res = bi_init(max(a->words, b->words) + 1);
-    uint64_t B = 1ull << 32;
-    uint64_t carry = 0;
-    for (int i = 0; i < max(a->words, b->words); i++) {
-        uint64_t a_word = i < a->words ? a->data[i] : 0;
-        uint64_t b_word = i < b->words ? b->data[i] : 0;
-
-        res->data[i] = (a_word + b_word + carry) % B;
-        carry = (a_word + b_word + carry) / B;
-    }
-
-    res->data[res->words - 1] = carry;
-
-    bi_squeeze(res);
+    bi_add_into(res, a, b);
 
     return res;
 }
 
-void bi_add_in_place(MPI a, MPI b) {
-    bi_squeeze(a);
-    uint32_t carry = 0;
-    unsigned long sum;
-    for (uint32_t i = 0; i < min(a->words, b->words); i++) {
-        sum = (unsigned long)(a->data[i]) + (unsigned long)b->data[i] + carry;
-        a->data[i] = (uint32_t)(sum & 0xFFFFFFFF);
-
-        carry = (uint32_t)(sum >> 32);
-
-        if (carry && i > 0) {
-            a->data[i + 1] += carry;
-        }
-    }
-
-    if (carry) {
-        bi_pad_words(a, 1);
-        a->data[a->words - 1] = carry;
-    }
-}
+void bi_add_in_place(MPI a, MPI b) { bi_add_into(a, a, b); }
 
 MPI bi_sub(MPI a, MPI b) {
 
     bi_squeeze(a);
     bi_squeeze(b);
 
-    // we're working with uint32_ts, so if b is greater than a, we'll
-    // set the result to 0 and return early
-    if (!bi_ge(a, b)) {
-        MPI res = bi_init_like(a);
-        bi_set(res, 0u);
-        return res;
-    }
-
-    // invariant: a >= b
+    // we're working with unsigned words, so if b is greater than a, the
+    // result is clamped to 0
     MPI res = bi_init(max(a->words, b->words));
-    uint64_t base = 1LL << 32;
-    uint64_t carry = base;
-    uint32_t a_word;
-    uint32_t b_word;
-    for (uint32_t i = 0; i < max(a->words, b->words); i++) {
-        a_word = i < a->words ? a->data[i] : 0;
-        b_word = i < b->words ? b->data[i] : 0;
-
-        carry = base - 1 + a_word - b_word + carry / base;
-
-        res->data[i] = carry % base;
-    }
-
-    bi_squeeze(res);
+    bi_sub_into(res, a, b);
 
     return res;
 }
 
 // a -= b
-void bi_sub_in_place(MPI a, MPI b) {
-    // TODO: actually implement an in place subtraction
-    MPI res = bi_sub(a, b);
-    bi_free(a);
-    a->data = res->data;
-    a->words = res->words;
-}
-
-MPI _bi_sub(MPI a, MPI b) {
-    MPI res = bi_init_like(a);
-    MPI a_copy = bi_init_like(a);
-    bi_copy(a, a_copy);
-
-    // we're working with uint32_ts, so if b is greater than a, we'll
-    // set the result to 0 and return early
-    if (!bi_ge(a, b)) {
-        bi_set(res, 0u);
-        return res;
-    }
-
-    // sanity check...
-    if (a->words == 0 || b->words == 0) {
-        printf(
-            "WARNIGN: trying to do subtraction with 0-length MPIs. a.words=%d, "
-            "b.words=%d",
-            a->words, b->words);
-    }
-
-    // TODO: future Will -> this can't be the best way to do this. Surely
-    // we'll need to revisit this and make it smarter.
-
-    uint64_t sub_from;
-    for (uint32_t i = 0; i < b->words; i++) {
-        if (a_copy->data[i] >= b->data[i]) {
-            res->data[i] = a_copy->data[i] - b->data[i];
-        } else {
-            // we need to go and get that bump
-            uint32_t j = i + 1;
-
-            // go to the left until we find something greater than
-            // 0.
-            while (j >= 0 && a_copy->data[j] == 0u)
-                j++;
-
-            // we found something greater then zero. We'll decrement
-            // it and then carry the value back to the right again
-
-            a_copy->data[j]--;
-
-            // now move back to the right again, setting all the
-            // zeros we find along the way to the max value (we know
-            // they're zeros currently)
-            j--;
-            while (j != i) {
-                a_copy->data[j] = 0xFFFFFFFF;
-                j--;
-            }
-
-            // we can now compute the subtraction for the ith
-            // place
-
-            sub_from = (unsigned long)a_copy->data[i];
-            sub_from += 1ul << 63;
-            sub_from -= (unsigned long)b->data[i];
-            sub_from &= 0xFFFFFFFF;
-            res->data[i] = (uint32_t)sub_from;
-        }
-        /*
-        printf("step: %d. a->data[i]=%u, a_copy->data[i]=%u, b->data[i]=%u,
-        res->data[i]=%u\nres=", i, a->data[i], a_copy->data[i], b->data[i],
-        (*res)->data[i]); bi_printf(*res); printf("\n");
-        */
-    }
-
-    for (uint32_t i = b->words; i < res->words; i++) {
-        res->data[i] = a->data[i];
-    }
+void bi_sub_in_place(MPI a, MPI b) { bi_sub_into(a, a, b); }
 
-    bi_free(a_copy);
+MPI bi_mul_imm(MPI a, uint32_t x) {
+    MPI res = bi_init(2 * a->words);
+    res->data[a->words] = __bi_kernels.mul_1(res->data, a->data, a->words, x);
 
-    bi_squeeze(res);
     return res;
 }
 
-MPI bi_mul_imm(MPI a, uint32_t x) {
-    MPI res = bi_init(2 * a->words);
-    uint64_t base = 1LL << 32;
-    uint64_t carry = 0;
+MPI bi_mul(MPI a, MPI b) {
+    MPI res = bi_init(a->words + b->words);
 
-    for (uint32_t i = 0; i < a->words; i++) {
-        res->data[i] = (a->data[i] * x + carry) % base;
-        carry = (a->data[i] * x + carry) / base;
-    }
+    __bi_mul_words(res->data, a->data, a->words, b->data, b->words);
 
+    bi_squeeze(res);
     return res;
 }
 
-MPI bi_mul(MPI a, MPI b) {
-    // linear convolution
-    // https://www.hvks.com/Numerical/Downloads/HVE%20The%20Math%20behind%20arbitrary%20precision.pdf
-    // page 11/12
-
-    uint32_t n = a->words;
-    uint32_t m = b->words;
-    MPI res = bi_init(n + m);
-
-    for (uint32_t i = 0; i < m; i++) {
-        uint64_t carry = 0;
-        for (uint32_t j = 0; j < n; j++) {
-            uint64_t tmp = (uint64_t)a->data[j] * (uint64_t)b->data[i];
-            uint32_t tmp_low = (uint32_t)tmp;
-            uint32_t tmp_hi = (uint32_t)(tmp >> 32);
-            uint32_t s1 = tmp_low + res->data[i + j];
-            uint32_t c1 = s1 < tmp_low;
-            uint32_t carry_low = (uint32_t)carry;
-            uint32_t s2 = s1 + carry_low;
-            uint32_t c2 = s2 < carry_low;
-            res->data[i + j] = s2;
-            carry = (uint64_t)tmp_hi + c1 + c2 + (carry >> 32);
-        }
+MPI bi_sqr(MPI a) {
+    MPI res = bi_init(2 * a->words);
 
-        uint32_t k = i + n;
-        while (carry) {
-            uint32_t carry_low = (uint32_t)carry;
-            uint32_t old = res->data[k];
-            res->data[k] += carry_low;
-            uint32_t spill = res->data[k] < old;
-            carry = (carry >> 32) + spill;
-            k++;
-        }
-    }
+    __bi_sqr_words(res->data, a->data, a->words);
 
     bi_squeeze(res);
     return res;
@@ -377,7 +226,7 @@ MPI bi_pow_imm(MPI b, uint32_t p) {
 
         p /= 2;
 
-        MPI tmp = bi_mul(b_copy, b_copy);
+        MPI tmp = bi_sqr(b_copy);
         bi_free(b_copy);
         b_copy = bi_init_and_copy(tmp);
         bi_free(tmp);
@@ -388,9 +237,51 @@ MPI bi_pow_imm(MPI b, uint32_t p) {
     return r;
 }
 
-uint32_t leading_zeros(uint32_t x) {
+uint32_t leading_zeros(bi_word_t x) {
     // gcc has a builtin helper for this
-    return __builtin_clz(x);
+    return __bi_clz(x);
+}
+
+void __bi_div_words(bi_word_t *q, bi_word_t *r, const bi_word_t *u,
+                    uint32_t m, const bi_word_t *v, uint32_t n) {
+    const bi_dword_t B = (bi_dword_t)1 << BI_WORD_BITS;
+
+    if (n == 1) {
+        // schoolbook short division, top down so q may alias u
+        bi_word_t d = v[0];
+        bi_dword_t rem = 0;
+        for (uint32_t i = m; i-- > 0;) {
+            bi_dword_t cur = rem * B + u[i];
+            if (q) {
+                q[i] = (bi_word_t)(cur / d);
+            }
+            rem = cur % d;
+        }
+
+        if (r) {
+            r[0] = (bi_word_t)rem;
+        }
+
+        return;
+    }
+
+    size_t mark = __bi_scratch_mark();
+
+    // D1: Normalise, working on scratch copies so that q and r are free to
+    // alias u and v
+    uint32_t D = leading_zeros(v[n - 1]);
+    bi_word_t *U = __bi_scratch_alloc(m + 1);
+    bi_word_t *V = __bi_scratch_alloc(n);
+    U[m] = __bi_shl_bits(U, u, m, D);
+    __bi_shl_bits(V, v, n, D);
+
+    // D2-D7, then D8: Unnormalise
+    __bi_div_norm(q, U, m, V, n, __bi_div_reciprocal(V[n - 1], V[n - 2]));
+    if (r) {
+        __bi_div_unnorm(r, U, n, D);
+    }
+
+    __bi_scratch_release(mark);
 }
 
 // u / v
@@ -433,100 +324,22 @@ __bi_result_code_t __bi_eucl_div(MPI u, MPI v, MPI *q, MPI *r) {
         return __bi_eucl_div_imm(u, v->data[0], q, r);
     }
 
-    // D0: Define
-    MPI Ustruct = bi_pad_words(u, 1);
     uint32_t m = u->words;
-    MPI Vstruct = bi_init_and_copy(v);
-    uint32_t n = Vstruct->words;
-    const uint64_t B = 1ull << 32;
-    MPI Qstruct = bi_init(m - n + 1);
-
-    if (m < n || n <= 1 || v->data[n - 1] == 0) {
-        printf("Bad operands in knuth_d. m=%d, n=%d", m, n);
-        return BI_BAD_OPERANDS;
-    }
-
-    // D1: Normalise
-    uint32_t D = leading_zeros(Vstruct->data[n - 1]);
-    MPI Utmp = bi_shift_left(Ustruct, D);
-    MPI Vtmp = bi_shift_left(Vstruct, D);
-    bi_copy(Utmp, Ustruct);
-    bi_copy(Vtmp, Vstruct);
-    bi_free(Utmp);
-    bi_free(Vtmp);
-    Utmp = bi_pad_words(Ustruct, 1);
-    bi_copy(Utmp, Ustruct);
-    bi_free(Utmp);
-
-    // D2/D7: Loop setup
-    uint32_t *U = Ustruct->data;
-    uint32_t *V = Vstruct->data;
-    uint32_t *Q = Qstruct->data;
-
-    for (int32_t j = m - n; j >= 0; j--) {
-
-        // D3: Calculate q_hat
-        uint64_t div_num = (uint64_t)U[n + j] * B + U[n - 1 + j];
-        uint64_t div_den = V[n - 1];
-        uint64_t q_hat = div_num / div_den;
-        uint64_t r_hat = div_num % div_den;
-
-    again:
-        if (q_hat == B ||
-            q_hat * (uint64_t)V[n - 2] > (r_hat * B + (uint64_t)U[n - 2 + j])) {
-            q_hat--;
-            r_hat += V[n - 1];
-
-            if (r_hat < B) {
-                goto again;
-            }
-        }
-
-        // D4: Multiply and subtract
-        int64_t k = 0;
-        int64_t t;
-        for (uint32_t i = 0; i < n; i++) {
-            uint64_t p = q_hat * (uint64_t)V[i];
-            t = U[i + j] - k - (p & 0xFFFFFFFFLL);
-            U[i + j] = t;
-            k = (p >> 32) - (t >> 32);
-        }
-        t = U[j + n] - k;
-        U[j + n] = t;
-
-        // D5: Test remainder
-        Q[j] = (uint32_t)q_hat;
-
-        if (t < 0) {
-            // D6: Add back
-            Q[j]--;
-
-            k = 0;
-            for (uint32_t i = 0; i < n; i++) {
-                t = (uint64_t)U[i + j] + V[i] + k;
-                U[i + j] = t;
-                k = t >> 32;
-            }
-
-            // deliberately ignore overflow here, it's
-            // balanced out by the borrow in the subtraction
-            // above
-            U[j + n] += k;
-        }
-    }
+    uint32_t n = v->words;
+    MPI Qstruct = q ? bi_init(m - n + 1) : NULL;
+    MPI Rstruct = r ? bi_init(n) : NULL;
 
-    bi_free(Vstruct);
+    __bi_div_words(Qstruct ? Qstruct->data : NULL,
+                   Rstruct ? Rstruct->data : NULL, u->data, m, v->data, n);
 
     if (q) {
-
+        bi_squeeze(Qstruct);
         *q = Qstruct;
-    } else {
-        bi_free(Qstruct);
     }
 
     if (r) {
-        // D8: Unnormalise
-        *r = bi_shift_right(Ustruct, D);
+        bi_squeeze(Rstruct);
+        *r = Rstruct;
     }
 
     return BI_OK;
@@ -545,20 +358,21 @@ void bi_eucl_div(MPI u, MPI v, MPI *q, MPI *r) {
 void bi_print(MPI x) {
     printf("0x");
     for (int32_t i = x->words - 1; i > 0; i--) {
-        printf("%08x", x->data[i]);
+        printf(BI_WORD_FMT, x->data[i]);
     }
-    printf("%08x", x->data[0]);
+    printf(BI_WORD_FMT, x->data[0]);
 }
 
 void bi_printf(MPI x, FILE *fp) {
     for (int32_t i = x->words - 1; i >= 0; i--) {
-        fprintf(fp, "%08x", x->data[i]);
+        fprintf(fp, BI_WORD_FMT, x->data[i]);
     }
 }
 
 MPI from_hex_str(char *str) {
     uint32_t len = strlen(str);
-    uint32_t words = len / 8;
+    uint32_t word_chars = BI_WORD_BITS / 4;
+    uint32_t words = len / word_chars;
 
     MPI res = bi_init(words);
 
@@ -571,12 +385,12 @@ MPI from_hex_str(char *str) {
     char *endptr;
     for (uint32_t i = 0; i < words; i++) {
         // extract the substr for the curr word
-        char slice[9];
-        strncpy(slice, str + i, ((uint64_t)str + (i + 8ull)));
-        slice[8] = '\0';
+        char slice[BI_WORD_BITS / 4 + 1];
+        memcpy(slice, str + i * word_chars, word_chars);
+        slice[word_chars] = '\0';
 
         // parse the substr
-        res->data[res->words - i - 1] = strtoul(slice, &endptr, 16);
+        res->data[res->words - i - 1] = strtoull(slice, &endptr, 16);
 
         if (*endptr != '\0') {
             printf("Failed parsing MPI string %s\nExiting.", str);
@@ -588,34 +402,20 @@ MPI from_hex_str(char *str) {
 }
 
 void bi_inc(MPI x) {
-    uint32_t i = 0;
-    while (x->data[i] == 0xFFFFFFFF && i < x->words) {
-        x->data[i] = 0u;
-        i++;
-    }
-
-    if (i == x->words) {
-        MPI tmp = bi_pad_words(x, 1);
-        bi_copy(tmp, x);
-        bi_free(tmp);
-
+    bi_word_t one = 1;
+    if (__bi_add_words_in_place(x->data, x->words, &one, 1)) {
+        __bi_resize(x, x->words + 1);
         x->data[x->words - 1] = 1u;
-    } else {
-        x->data[i]++;
     }
 
     bi_squeeze(x);
 }
 
 void bi_dec(MPI x) {
-    uint32_t i = 0;
-    while (x->data[i] == 0u && i < x->words) {
-        x->data[i] = 0xFFFFFFFF;
-        i++;
-    }
-
-    if (x->data[i] != 0) {
-        x->data[i]--;
+    // 0 stays at 0, as with bi_sub
+    bi_word_t one = 1;
+    if (!bi_eq_val(x, 0)) {
+        __bi_sub_words_in_place(x->data, x->words, &one, 1);
     }
 
     bi_squeeze(x);
@@ -690,28 +490,9 @@ MPI bi_shift_left(MPI a, uint32_t n) {
     }
 
     bi_squeeze(a);
-    if (bi_eq_val(a, 0)) {
-        return bi_init(1);
-    }
-
-    uint32_t offset_words = n / 32;
-    uint32_t offset_mod = n % 32;
-
-    MPI res = bi_init(a->words + offset_words + 1);
-
-    for (uint32_t i = offset_words; i < res->words; i++) {
-        if (i < a->words + offset_words) {
-            uint32_t upper_fetch_word = a->data[i - offset_words];
-            res->data[i] += upper_fetch_word << offset_mod;
-        }
+    MPI res = bi_init(a->words + n / BI_WORD_BITS + 1);
+    bi_shift_left_into(res, a, n);
 
-        if (offset_mod && i > offset_words) {
-            uint32_t lower_fetch_word = a->data[i - offset_words - 1];
-            res->data[i] += lower_fetch_word >> (32 - offset_mod);
-        }
-    }
-
-    bi_squeeze(res);
     return res;
 }
 
@@ -720,32 +501,17 @@ MPI bi_shift_right(MPI a, uint32_t n) {
         return bi_init_and_copy(a);
     }
 
-    if (n >= 32 * a->words) {
-        return bi_init(1);
-    }
-
     bi_squeeze(a);
-    if (bi_eq_val(a, 0)) {
-        return bi_init(1);
-    }
-
     MPI res = bi_init_like(a);
+    bi_shift_right_into(res, a, n);
 
-    uint32_t offset_words = n / 32;
-    uint32_t offset_mod = n % 32;
-
-    for (uint32_t i = 0; i < res->words - offset_words; i++) {
-        uint32_t lower_fetch_word = a->data[i + offset_words + 0];
-        res->data[i] = ((uint64_t)lower_fetch_word >> offset_mod);
+    return res;
+}
 
-        if (i < a->words - offset_words - 1 && offset_mod) {
-            uint32_t upper_fetch_word = a->data[i + offset_words + 1];
-            res->data[i] += (upper_fetch_word << (32 - offset_mod));
-        }
-    }
+void bi_shift_left_in_place(MPI a, uint32_t n) { bi_shift_left_into(a, a, n); }
 
-    bi_squeeze(res);
-    return res;
+void bi_shift_right_in_place(MPI a, uint32_t n) {
+    bi_shift_right_into(a, a, n);
 }
 
 // a^b % n
@@ -761,134 +527,64 @@ MPI bi_mod_exp(MPI a, MPI b, MPI n) {
         return res;
     }
 
-    MPI res = bi_init(1u);
-    bi_set(res, 1u);
-    MPI base_tmp;
-    bi_eucl_div(a, n, NULL, &base_tmp);
-    MPI b_copy = bi_init_and_copy(b);
-
-    while (!bi_eq_val(b_copy, 0u)) {
-        if (!bi_even(b_copy)) {
-            // res = (res * a) % n
-            // TODO: replace with modular multiplication
-            MPI res_base = bi_mul(res, base_tmp);
-            MPI res_tmp;
-            bi_eucl_div(res_base, n, NULL, &res_tmp);
-            bi_copy(res_tmp, res);
-
-            bi_dec(b_copy);
-
-            bi_free(res_base);
-            bi_free(res_tmp);
-        } else {
-            // a = a^2 % n
-            MPI a_squared = bi_mul(base_tmp, base_tmp);
-            MPI base_tmp_tmp;
-            bi_eucl_div(a_squared, n, NULL, &base_tmp_tmp);
-            bi_copy(base_tmp_tmp, base_tmp);
-            bi_free(a_squared);
-            bi_free(base_tmp_tmp);
-
-            // b >>= 1
-            MPI b_tmp = bi_shift_right(b_copy, 1u);
-            bi_copy(b_tmp, b_copy);
-            bi_free(b_tmp);
+    if (!bi_even(n)) {
+#ifdef BI_HAVE_IFMA
+        if (__bi_ifma_usable(n)) {
+            return __bi_mod_exp_ifma(a, b, n, false);
         }
-    }
+#endif
 
-    bi_free(base_tmp);
-    bi_free(b_copy);
+        // odd modulus, so we can avoid dividing inside the loop
+        return __bi_mod_exp_mont(a, b, n);
+    }
 
-    return res;
+    // even modulus, so reduce with Barrett instead
+    return __bi_mod_exp_barrett(a, b, n);
 }
 
-bool bi_lt(MPI a, MPI b) {
-    if (a->words > b->words) {
-        for (uint32_t i = b->words; i < a->words; i++) {
-            if (a->data[i] > 0u) {
-                return false;
-            }
-        }
-    } else if (b->words > a->words) {
-        for (uint32_t i = a->words; i < b->words; i++) {
-            if (b->data[i] > 0u) {
-                return true;
-            }
-        }
+MPI bi_mod_multi_exp(MPI *a, MPI *b, uint32_t count, MPI n) {
+    if (bi_eq_val(n, 1u)) {
+        MPI res = bi_init(1u);
+        return res;
     }
-    if (a->words != b->words) {
-        // Honestly, not sure what to do here. I think for now I'll
-        // just return false
-        return false;
+
+    if (count == 0) {
+        MPI res = bi_init(1u);
+        bi_set(res, 1u);
+        return res;
     }
 
-    for (int32_t i = a->words - 1; i >= 0; i--) {
-        if (a->data[i] > b->data[i]) {
-            return false;
-        } else if (a->data[i] < b->data[i]) {
-            return true;
-        }
+    if (!bi_even(n)) {
+        return __bi_mod_multi_exp_mont(a, b, count, n);
     }
 
-    // a and b are equal
-    return false;
+    return __bi_mod_multi_exp_barrett(a, b, count, n);
 }
 
-bool bi_le(MPI a, MPI b) {
-    if (a->words > b->words) {
-        for (uint32_t i = b->words; i < a->words; i++) {
-            if (a->data[i] > 0u) {
-                return false;
-            }
-        }
-    } else if (b->words > a->words) {
-        for (uint32_t i = a->words; i < b->words; i++) {
-            if (b->data[i] > 0u) {
-                return true;
-            }
-        }
+// -1, 0 or 1 as a is below, equal to or above b. Leading zero words don't
+// count.
+static int __bi_cmp(MPI a, MPI b) {
+    uint32_t n = a->words;
+    uint32_t m = b->words;
+    while (n > 1 && a->data[n - 1] == 0) {
+        n--;
     }
-
-    if (a->words != b->words) {
-        // Honestly, not sure what to do here. I think for now I'll
-        // just return false
-        return false;
+    while (m > 1 && b->data[m - 1] == 0) {
+        m--;
     }
 
-    for (int32_t i = a->words - 1; i >= 0; i--) {
-        if (a->data[i] > b->data[i]) {
-            return false;
-        } else if (a->data[i] < b->data[i]) {
-            return true;
-        }
+    if (n != m) {
+        return n > m ? 1 : -1;
     }
 
-    // a and b are equal
-    return true;
+    return __bi_cmp_words(a->data, b->data, n);
 }
 
-bool bi_eq(MPI a, MPI b) {
-    for (uint32_t i = 0; i < min(a->words, b->words); i++) {
-        if (a->data[i] != b->data[i])
-            return false;
-    }
+bool bi_lt(MPI a, MPI b) { return __bi_cmp(a, b) < 0; }
 
-    if (a->words > b->words) {
-        for (uint32_t i = b->words; i < a->words; i++) {
-            if (a->data[i] != 0u) {
-                return false;
-            }
-        }
-    } else if (b->words > a->words) {
-        for (uint32_t i = a->words; i < b->words; i++) {
-            if (b->data[i] != 0u) {
-                return false;
-            }
-        }
-    }
+bool bi_le(MPI a, MPI b) { return __bi_cmp(a, b) <= 0; }
 
-    return true;
-}
+bool bi_eq(MPI a, MPI b) { return __bi_cmp(a, b) == 0; }
 
 bool bi_eq_val(MPI a, uint32_t b) {
     for (uint32_t i = 1; i < a->words; i++) {
@@ -899,65 +595,15 @@ bool bi_eq_val(MPI a, uint32_t b) {
     return a->data[0] == b;
 }
 
-bool bi_gt(MPI a, MPI b) {
-    if (a->words > b->words) {
-        for (uint32_t i = b->words; i < a->words; i++) {
-            if (a->data[i] > 0u) {
-                return true;
-            }
-        }
-    } else if (b->words > a->words) {
-        for (uint32_t i = a->words; i < b->words; i++) {
-            if (b->data[i] > 0u) {
-                return false;
-            }
-        }
-    }
-
-    for (int32_t i = min(a->words, b->words) - 1; i >= 0; i--) {
-        if (a->data[i] > b->data[i]) {
-            return true;
-        } else if (a->data[i] < b->data[i]) {
-            return false;
-        }
-    }
-
-    // a and b are equal
-    return false;
-}
-bool bi_ge(MPI a, MPI b) {
-    if (a->words > b->words) {
-        for (uint32_t i = b->words; i < a->words; i++) {
-            if (a->data[i] > 0u) {
-                return true;
-            }
-        }
-    } else if (b->words > a->words) {
-        for (uint32_t i = a->words; i < b->words; i++) {
-            if (b->data[i] > 0u) {
-                return false;
-            }
-        }
-    }
-
-    for (int32_t i = min(a->words, b->words) - 1; i >= 0; i--) {
-        if (a->data[i] > b->data[i]) {
-            return true;
-        } else if (a->data[i] < b->data[i]) {
-            return false;
-        }
-    }
+bool bi_gt(MPI a, MPI b) { return __bi_cmp(a, b) > 0; }
 
-    // a and b are equal
-    return true;
-}
+bool bi_ge(MPI a, MPI b) { return __bi_cmp(a, b) >= 0; }
 
 MPI bi_concat(MPI a, MPI b) {
     MPI res = bi_init(a->words + b->words);
 
-    res->data = malloc(res->words * sizeof(uint32_t));
-    memcpy(res->data, a->data, a->words * sizeof(uint32_t));
-    memcpy(&(res->data[a->words]), b->data, b->words * sizeof(uint32_t));
+    memcpy(res->data, a->data, a->words * sizeof(bi_word_t));
+    memcpy(&(res->data[a->words]), b->data, b->words * sizeof(bi_word_t));
 
     return res;
 }
@@ -972,6 +618,24 @@ MPI bi_init_and_copy(MPI src) {
 
 bool bi_even(MPI a) { return !(a->data[0] & 1u); }
 
+uint32_t bi_bit_length(MPI a) {
+    for (int32_t i = a->words - 1; i >= 0; i--) {
+        if (a->data[i] != 0u) {
+            return BI_WORD_BITS * i + BI_WORD_BITS - leading_zeros(a->data[i]);
+        }
+    }
+
+    return 0;
+}
+
+bool bi_test_bit(MPI a, uint32_t i) {
+    if (i / BI_WORD_BITS >= a->words) {
+        return false;
+    }
+
+    return (a->data[i / BI_WORD_BITS] >> (i % BI_WORD_BITS)) & 1u;
+}
+
 MPI bi_pad_words(MPI x, uint32_t n) {
     MPI res = bi_init(x->words + n);
     res->words = x->words + n;
@@ -994,24 +658,12 @@ MPI bi_pad_words_from_bottom(MPI x, uint32_t n) {
     return res;
 }
 
-void bi_squeeze(MPI x) {
-    uint32_t new_words = x->words;
-
-    while (new_words > 1 && x->data[new_words - 1] == 0u) {
-        new_words--;
-    }
-
-    if (new_words == x->words) {
-        return;
-    }
-
-    x->data = realloc(x->data, new_words * sizeof(uint32_t));
-    x->words = new_words;
-}
+// Only the length changes, the storage is kept for the value to grow back into
+void bi_squeeze(MPI x) { __bi_trim(x); }
 
 // slices a from start to end, exclusive at both ends
 __bi_result_t __bi_slice(MPI a, uint32_t start, uint32_t end) {
-    if (end <= start || start >= a->words * 32u) {
+    if (end <= start || start >= a->words * BI_WORD_BITS) {
         return bi_result_error(BI_BAD_OPERANDS);
     }
 
@@ -1073,16 +725,10 @@ __bi_result_code_t __bi_add_to_range(MPI src, MPI target,
         return BI_BAD_OPERANDS;
     }
 
-    uint64_t carry = 0;
-    for (uint32_t i = 0; i < range_words; i++) {
-        target->data[target_start_idx + i] += src->data[src_start_idx + i];
-        uint64_t res = (uint64_t)target->data[target_start_idx + i] +
-                       (uint64_t)src->data[target_start_idx + i] + carry;
-        target->data[target_start_idx + i] = (uint32_t)res;
-        carry = res >> 32u;
-    }
-
-    // TODO: what happens if carry != 0 here??
+    // a carry out of the top of target is dropped
+    __bi_add_words_in_place(target->data + target_start_idx,
+                            target->words - target_start_idx,
+                            src->data + src_start_idx, range_words);
 
     return BI_OK;
 }
@@ -1098,16 +744,16 @@ void bi_add_to_range(MPI src, MPI target, uint32_t src_start_idx,
     }
 }
 
-__bi_result_code_t __bi_eucl_div_imm(MPI a, uint32_t b, MPI *q, MPI *r) {
+__bi_result_code_t __bi_eucl_div_imm(MPI a, bi_word_t b, MPI *q, MPI *r) {
     if (b == 0) {
         return BI_DIV_ZERO;
     }
 
     MPI q_ = bi_init_like(a);
-    uint64_t r_ = 0;
+    bi_dword_t r_ = 0;
 
     for (int i = a->words - 1; i >= 0; i--) {
-        uint64_t x = (r_ << 32) | a->data[i];
+        bi_dword_t x = (r_ << BI_WORD_BITS) | a->data[i];
         q_->data[i] = x / b;
         r_ = x % b;
     }
@@ -1137,13 +783,13 @@ uint64_t trailing_zeros(MPI a) {
     uint64_t sum = 0;
 
     for (uint32_t i = 0; i < a->words; i++) {
-        uint32_t v = a->data[i];
+        bi_word_t v = a->data[i];
 
         if (v == 0) {
-            sum += 32;
+            sum += BI_WORD_BITS;
 
         } else {
-            uint64_t curr_word_ctz = __builtin_ctz(v);
+            uint64_t curr_word_ctz = __bi_ctz(v);
             sum += curr_word_ctz;
             break;
         }
@@ -1152,6 +798,18 @@ uint64_t trailing_zeros(MPI a) {
     return sum;
 }
 
+uint32_t bi_strip_trailing_zeros(MPI a) {
+    if (bi_eq_val(a, 0)) {
+        return 0;
+    }
+
+    // one word parallel pass, rather than a bit at a time
+    uint32_t n = (uint32_t)trailing_zeros(a);
+    bi_shift_right_into(a, a, n);
+
+    return n;
+}
+
 MPI bi_gcd(MPI a, MPI b) {
     // gcd(x, 0) = x
     if (bi_eq_val(a, 0) && !bi_eq_val(b, 0)) {
@@ -1169,13 +827,9 @@ MPI bi_gcd(MPI a, MPI b) {
     bi_squeeze(a);
     bi_squeeze(b);
 
-    ext_euc_res_t tmp = ext_euc(a, b);
-
-    MPI res = to_unsigned(tmp.gcd);
-
-    signed_free(tmp.gcd);
-    signed_free(tmp.bez_x);
-    signed_free(tmp.bez_y);
+    // no cofactors needed
+    MPI res = bi_init(1);
+    __bi_gcdext(res, NULL, NULL, a, b);
 
     return res;
 }
@@ -1201,41 +855,19 @@ MPI bi_lcm(MPI a, MPI b) {
 
 // computes a^-1 mod b, where the result is shifted to be positive
 MPI bi_mod_mult_inv(MPI a, MPI b) {
-    ext_euc_res_t tmp = ext_euc(a, b);
+    MPI res = bi_init(1);
+    __bi_result_code_t code = __bi_mod_inv(res, a, b);
 
-    if (!signed_eq_val(tmp.gcd, 1, true)) {
+    if (code == BI_BAD_OPERANDS) {
         printf("ERROR: bi_mod_mult_inv: gcd(a, b) != 1, where:\na=");
         bi_print(a);
         printf("\nb=");
         bi_print(b);
-
-        // TODO: re-enable this failure once the bug is found
+        exit(1);
+    } else if (code != BI_OK) {
+        printf("ERROR in bi_mod_mult_inv, code: %d", code);
         exit(1);
     }
 
-    signed_free(tmp.bez_y);
-    signed_free(tmp.gcd);
-
-    sMPI btmp = from_unsigned(b, true);
-    MPI res;
-    sMPI q;
-    signed_eucl_div(tmp.bez_x, btmp, &q, &res);
-
-    signed_free(btmp);
-    signed_free(q);
-
     return res;
-
-    // if (tmp.bez_x.positive) {
-
-    //     return tmp.bez_x.val;
-    // } else {
-    //     sMPI b_tmp = from_unsigned(b, true);
-    //     sMPI res = signed_add(b_tmp, tmp.bez_x);
-
-    //     signed_free(tmp.bez_x);
-    //     signed_free(b_tmp);
-
-    //     return res.val;
-    // }
 }
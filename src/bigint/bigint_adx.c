@@ -0,0 +1,140 @@
+#include <bigint/bigint.h>
+#include <stdint.h>
+
+#include "bigint_internal.h"
+
+#ifdef BI_HAVE_ADX
+
+/*
+ * Row kernels for CPUs with BMI2 and ADX. MULX multiplies without touching
+ * the flags, and ADCX / ADOX add with carry through CF and OF only, so the
+ * low halves of the products and the high halves carried over from the last
+ * limb are summed in two independent carry chains instead of one serial
+ * one. The loop advances with LEA and tests with JRCXZ, neither of which
+ * disturbs the flags either.
+ *
+ * Only built for 64 bit limbs. With 32 bit limbs the generic C already does
+ * each step as one 64 bit multiply-add with no carry chain to speak of, and
+ * benchmarks no slower than these would.
+ */
+
+// Limbs per trip round the asm loops
+#define BI_ADX_UNROLL 4
+
+#define BI_ADX_A(off) #off "(%[a],%[i],8)"
+#define BI_ADX_R(off) #off "(%[r],%[i],8)"
+
+// r = a * b + carry for one limb, with carry the previous high half
+#define BI_ADX_MUL_STEP(off)                                                   \
+    "mulx " BI_ADX_A(off) ", %[lo], %[hi]\n\t"                                 \
+    "adcx %[carry], %[lo]\n\t"                                                 \
+    "mov %[lo], " BI_ADX_R(off) "\n\t"                                         \
+    "mov %[hi], %[carry]\n\t"
+
+// r += a * b, with the high halves on OF and the sums into r on CF. flip is
+// either empty or a NOT of t, which turns the add into a subtract as
+// ~(~r + p) = r - p.
+#define BI_ADX_ADDMUL_STEP(off, flip)                                          \
+    "mulx " BI_ADX_A(off) ", %[lo], %[hi]\n\t"                                 \
+    "adox %[carry], %[lo]\n\t"                                                 \
+    "mov " BI_ADX_R(off) ", %[t]\n\t"                                          \
+    flip                                                                       \
+    "adcx %[lo], %[t]\n\t"                                                     \
+    flip                                                                       \
+    "mov %[t], " BI_ADX_R(off) "\n\t"                                          \
+    "mov %[hi], %[carry]\n\t"
+
+#define BI_ADX_NOT "not %[t]\n\t"
+
+// the unrolled loop, which finishes by adding both carry flags into carry
+#define BI_ADX_ADDMUL_LOOP(flip)                                               \
+    "xor %[lo], %[lo]\n\t"                                                     \
+    "1:\n\t"                                                                   \
+    BI_ADX_ADDMUL_STEP(0, flip)                                                \
+    BI_ADX_ADDMUL_STEP(8, flip)                                                \
+    BI_ADX_ADDMUL_STEP(16, flip)                                               \
+    BI_ADX_ADDMUL_STEP(24, flip)                                               \
+    "lea 4(%[i]), %[i]\n\t"                                                    \
+    "jrcxz 2f\n\t"                                                             \
+    "jmp 1b\n"                                                                 \
+    "2:\n\t"                                                                   \
+    "mov $0, %[lo]\n\t"                                                        \
+    "adox %[lo], %[carry]\n\t"                                                 \
+    "adcx %[lo], %[carry]"
+
+// The asm loops run from i = -blocks * BI_ADX_UNROLL up to 0, indexing back
+// from the end of the unrolled part. Anything left over is done first in C.
+bi_word_t __bi_mul_1_adx(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                         bi_word_t b) {
+    uint32_t head = n % BI_ADX_UNROLL;
+    bi_word_t carry = __bi_mul_1(r, a, head, b);
+    if (n == head) {
+        return carry;
+    }
+
+    intptr_t i = -(intptr_t)(n - head);
+    bi_word_t lo, hi;
+
+    __asm__ volatile("xor %[lo], %[lo]\n\t"
+                     "1:\n\t"
+                     BI_ADX_MUL_STEP(0)
+                     BI_ADX_MUL_STEP(8)
+                     BI_ADX_MUL_STEP(16)
+                     BI_ADX_MUL_STEP(24)
+                     "lea 4(%[i]), %[i]\n\t"
+                     "jrcxz 2f\n\t"
+                     "jmp 1b\n"
+                     "2:\n\t"
+                     "mov $0, %[lo]\n\t"
+                     "adcx %[lo], %[carry]"
+                     : [i] "+c"(i), [carry] "+r"(carry), [lo] "=&r"(lo),
+                       [hi] "=&r"(hi)
+                     : [r] "r"(r + n), [a] "r"(a + n), "d"(b)
+                     : "cc", "memory");
+
+    return carry;
+}
+
+bi_word_t __bi_addmul_1_adx(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                            bi_word_t b) {
+    uint32_t head = n % BI_ADX_UNROLL;
+    bi_word_t carry = __bi_addmul_1(r, a, head, b);
+    if (n == head) {
+        return carry;
+    }
+
+    intptr_t i = -(intptr_t)(n - head);
+    bi_word_t lo, hi, t;
+
+    __asm__ volatile(BI_ADX_ADDMUL_LOOP("")
+                     : [i] "+c"(i), [carry] "+r"(carry), [lo] "=&r"(lo),
+                       [hi] "=&r"(hi), [t] "=&r"(t)
+                     : [r] "r"(r + n), [a] "r"(a + n), "d"(b)
+                     : "cc", "memory");
+
+    return carry;
+}
+
+bi_word_t __bi_submul_1_adx(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                            bi_word_t b) {
+    uint32_t head = n % BI_ADX_UNROLL;
+    bi_word_t borrow = __bi_submul_1(r, a, head, b);
+    if (n == head) {
+        return borrow;
+    }
+
+    // the borrow into the complemented add is the carry into it, and the
+    // carry out of it is the borrow out
+    intptr_t i = -(intptr_t)(n - head);
+    bi_word_t lo, hi, t;
+
+    __asm__ volatile(BI_ADX_ADDMUL_LOOP(BI_ADX_NOT)
+                     : [i] "+c"(i), [carry] "+r"(borrow), [lo] "=&r"(lo),
+                       [hi] "=&r"(hi), [t] "=&r"(t)
+                     : [r] "r"(r + n), [a] "r"(a + n), "d"(b)
+                     : "cc", "memory");
+
+    return borrow;
+}
+
+#endif
@@ -0,0 +1,262 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+void bi_barrett_init(bi_barrett_ctx_t *ctx, MPI n) {
+    if (bi_eq_val(n, 0)) {
+        printf("ERROR in bi_barrett_init, code: %d", BI_DIV_ZERO);
+        exit(1);
+    }
+
+    ctx->n = bi_init_and_copy(n);
+    bi_squeeze(ctx->n);
+
+    // mu = B^2k / n, which is a single bit in word 2k over n
+    uint32_t k = ctx->n->words;
+    MPI b2k = bi_init(2 * k + 1);
+    b2k->data[2 * k] = 1u;
+    ctx->mu = bi_init(1);
+    bi_eucl_div_into(ctx->mu, NULL, b2k, ctx->n);
+    bi_free(b2k);
+}
+
+void bi_barrett_free(bi_barrett_ctx_t *ctx) {
+    bi_free(ctx->n);
+    bi_free(ctx->mu);
+}
+
+// Words skip and up of a * b, where r has na + nb words. Partial products
+// that would land below word skip are left out, so the result can be short
+// by the carries they would have made.
+static void __bi_mul_high(bi_word_t *r, const bi_word_t *a, uint32_t na,
+                          const bi_word_t *b, uint32_t nb, uint32_t skip) {
+    memset(r, 0, (size_t)(na + nb) * sizeof(bi_word_t));
+
+    for (uint32_t i = 0; i < na; i++) {
+        uint32_t j = i < skip ? skip - i : 0;
+        if (j < nb) {
+            r[i + nb] = __bi_kernels.addmul_1(r + i + j, b + j, nb - j, a[i]);
+        }
+    }
+}
+
+// The low l words of a * b
+static void __bi_mul_low(bi_word_t *r, const bi_word_t *a, uint32_t na,
+                         const bi_word_t *b, uint32_t nb, uint32_t l) {
+    memset(r, 0, (size_t)l * sizeof(bi_word_t));
+
+    for (uint32_t i = 0; i < na && i < l; i++) {
+        uint32_t end = l - i < nb ? l - i : nb;
+        bi_word_t carry = __bi_kernels.addmul_1(r + i, b, end, a[i]);
+        if (i + end < l) {
+            r[i + end] = (bi_word_t)carry;
+        }
+    }
+}
+
+// Scratch words needed by __bi_barrett_reduce
+static size_t __bi_barrett_scratch(bi_barrett_ctx_t *ctx) {
+    size_t k = ctx->n->words;
+    return (k + 1 + ctx->mu->words) + 2 * (k + 1);
+}
+
+// r = x mod n, where x has 2k words and r has k words (HAC 14.42). t is
+// scratch space of __bi_barrett_scratch words. r may alias x.
+static void __bi_barrett_reduce(bi_word_t *r, const bi_word_t *x, bi_word_t *t,
+                                bi_barrett_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    const bi_word_t *n = ctx->n->data;
+    uint32_t mu_words = ctx->mu->words;
+
+    // q = (x / B^(k-1)) * mu / B^(k+1) is at most 3 below x / n, counting
+    // the carries lost by only summing the top half of the product. It fits
+    // in k + 1 words as n >= B^(k-1).
+    bi_word_t *q2 = t;
+    __bi_mul_high(q2, x + k - 1, k + 1, ctx->mu->data, mu_words, k - 1);
+    bi_word_t *q = q2 + k + 1;
+
+    // x - q * n, which is below 4n, so only the low k + 1 words matter
+    bi_word_t *qn = q2 + k + 1 + mu_words;
+    __bi_mul_low(qn, q, k + 1, n, k, k + 1);
+    bi_word_t *u = qn + k + 1;
+    __bi_sub_words(u, x, k + 1, qn, k + 1);
+
+    while (u[k] != 0 || __bi_cmp_words(u, n, k) >= 0) {
+        __bi_sub_words(u, u, k + 1, n, k);
+    }
+
+    memcpy(r, u, k * sizeof(bi_word_t));
+}
+
+// r = a * b mod n, for k word a, b < n. r may alias a or b.
+static void __bi_barrett_mul_words(bi_word_t *r, const bi_word_t *a,
+                                   const bi_word_t *b, bi_word_t *t,
+                                   void *ctx) {
+    uint32_t k = ((bi_barrett_ctx_t *)ctx)->n->words;
+
+    __bi_mul_words(t, a, k, b, k);
+    __bi_barrett_reduce(r, t, t + 2 * k, ctx);
+}
+
+static void __bi_barrett_sqr_words(bi_word_t *r, const bi_word_t *a,
+                                   bi_word_t *t, void *ctx) {
+    uint32_t k = ((bi_barrett_ctx_t *)ctx)->n->words;
+
+    __bi_sqr_words(t, a, k);
+    __bi_barrett_reduce(r, t, t + 2 * k, ctx);
+}
+
+// copies x into a zero padded buffer of words words, truncating if it's
+// longer
+static void __bi_barrett_load(bi_word_t *dst, MPI x, uint32_t words) {
+    memset(dst, 0, words * sizeof(bi_word_t));
+    memcpy(dst, x->data, (x->words < words ? x->words : words) *
+                             sizeof(bi_word_t));
+}
+
+void bi_barrett_mod_into(MPI dst, MPI x, bi_barrett_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+
+    uint32_t x_words = x->words;
+    while (x_words > 1 && x->data[x_words - 1] == 0) {
+        x_words--;
+    }
+
+    if (x_words > 2 * k) {
+        // too big for a single Barrett step
+        bi_eucl_div_into(NULL, dst, x, ctx->n);
+        return;
+    }
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *x_ = __bi_scratch_alloc(2 * (size_t)k);
+    bi_word_t *t = __bi_scratch_alloc(__bi_barrett_scratch(ctx));
+    __bi_barrett_load(x_, x, 2 * k);
+
+    __bi_resize(dst, k);
+    __bi_barrett_reduce(dst->data, x_, t, ctx);
+    __bi_scratch_release(mark);
+
+    __bi_trim(dst);
+}
+
+MPI bi_barrett_mod(MPI x, bi_barrett_ctx_t *ctx) {
+    MPI res = bi_init(ctx->n->words);
+    bi_barrett_mod_into(res, x, ctx);
+
+    return res;
+}
+
+void bi_mod_mul_into(MPI dst, MPI a, MPI b, bi_barrett_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *a_ = __bi_scratch_alloc(k);
+    bi_word_t *b_ = __bi_scratch_alloc(k);
+    bi_word_t *t = __bi_scratch_alloc(2 * k + __bi_barrett_scratch(ctx));
+
+    __bi_barrett_load(a_, a, k);
+    __bi_barrett_load(b_, b, k);
+
+    // the operands have been copied out, so dst can be one of them
+    __bi_resize(dst, k);
+    __bi_barrett_mul_words(dst->data, a_, b_, t, ctx);
+    __bi_scratch_release(mark);
+
+    __bi_trim(dst);
+}
+
+MPI bi_mod_mul(MPI a, MPI b, bi_barrett_ctx_t *ctx) {
+    MPI res = bi_init(ctx->n->words);
+    bi_mod_mul_into(res, a, b, ctx);
+
+    return res;
+}
+
+void bi_mod_sqr_into(MPI dst, MPI a, bi_barrett_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *a_ = __bi_scratch_alloc(k);
+    bi_word_t *t = __bi_scratch_alloc(2 * k + __bi_barrett_scratch(ctx));
+
+    __bi_barrett_load(a_, a, k);
+
+    __bi_resize(dst, k);
+    __bi_barrett_sqr_words(dst->data, a_, t, ctx);
+    __bi_scratch_release(mark);
+
+    __bi_trim(dst);
+}
+
+MPI bi_mod_sqr(MPI a, bi_barrett_ctx_t *ctx) {
+    MPI res = bi_init(ctx->n->words);
+    bi_mod_sqr_into(res, a, ctx);
+
+    return res;
+}
+
+__bi_modmul_t __bi_barrett_modmul(bi_barrett_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    __bi_modmul_t mm = {
+        .k = k,
+        .scratch_words = 2 * (size_t)k + __bi_barrett_scratch(ctx),
+        .mul = __bi_barrett_mul_words,
+        .sqr = __bi_barrett_sqr_words,
+        .ctx = ctx,
+    };
+
+    return mm;
+}
+
+MPI __bi_mod_exp_barrett(MPI a, MPI b, MPI n) {
+    bi_barrett_ctx_t ctx;
+    bi_barrett_init(&ctx, n);
+    uint32_t k = ctx.n->words;
+
+    __bi_modmul_t mm = __bi_barrett_modmul(&ctx);
+
+    MPI base = bi_barrett_mod(a, &ctx);
+    __bi_resize(base, k);
+
+    MPI res = bi_init(k);
+    __bi_window_exp(res->data, base->data, b, &mm);
+    __bi_trim(res);
+
+    bi_free(base);
+    bi_barrett_free(&ctx);
+
+    return res;
+}
+
+MPI __bi_mod_multi_exp_barrett(MPI *a, MPI *b, uint32_t count, MPI n) {
+    bi_barrett_ctx_t ctx;
+    bi_barrett_init(&ctx, n);
+    uint32_t k = ctx.n->words;
+
+    __bi_modmul_t mm = __bi_barrett_modmul(&ctx);
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *bases = __bi_scratch_alloc((size_t)count * k);
+    bi_word_t *one = __bi_scratch_alloc(k);
+
+    MPI x = bi_init(k);
+    for (uint32_t i = 0; i < count; i++) {
+        bi_barrett_mod_into(x, a[i], &ctx);
+        __bi_resize(x, k);
+        memcpy(bases + (size_t)i * k, x->data, k * sizeof(bi_word_t));
+    }
+    memset(one, 0, k * sizeof(bi_word_t));
+    one[0] = 1u;
+
+    __bi_multi_exp(x->data, one, bases, b, count, &mm);
+    __bi_scratch_release(mark);
+    __bi_trim(x);
+
+    bi_barrett_free(&ctx);
+
+    return x;
+}
@@ -0,0 +1,156 @@
+#include <bigint/bigint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bigint_internal.h"
+
+/*
+ * Many exponentiations against one modulus, spread over a pool of threads.
+ * The reduction context is built once and only read from then on, and each
+ * thread does its products in its own scratch arena, so the workers share
+ * nothing but a counter. Each takes the next unclaimed index until there are
+ * none left, which keeps them all busy when exponents differ in length.
+ */
+
+// Most worker threads a batch will start
+#define BI_BATCH_MAX_THREADS 256
+
+typedef struct {
+    MPI *out;
+    MPI *a;
+    MPI *b;
+    MPI e;
+    uint32_t count;
+    atomic_uint next; // next index to be claimed
+
+    // the same backend bi_mod_exp would pick for n
+    bool odd;
+    bi_mont_ctx_t mont;
+    void *ifma;
+    bi_barrett_ctx_t barrett;
+    __bi_modmul_t mm;
+} __bi_batch_t;
+
+// out[i] = a[i]^b[i] mod n, or a[i]^e
+static void __bi_batch_one(__bi_batch_t *batch, uint32_t i, bi_word_t *base,
+                           bi_word_t *r, MPI x) {
+    MPI n = batch->odd ? batch->mont.n : batch->barrett.n;
+    MPI e = batch->b ? batch->b[i] : batch->e;
+    uint32_t k = batch->mm.k;
+
+    if (bi_eq_val(e, 0u)) {
+        bi_set(x, 1u);
+    } else if (batch->odd) {
+        bi_eucl_div_into(NULL, x, batch->a[i], n);
+        __bi_mont_enter(base, x, &batch->mont, batch->ifma);
+        __bi_window_exp(r, base, e, &batch->mm);
+        __bi_mont_leave(x, r, &batch->mont, batch->ifma);
+    } else {
+        bi_barrett_mod_into(x, batch->a[i], &batch->barrett);
+        __bi_resize(x, k);
+        __bi_window_exp(r, x->data, e, &batch->mm);
+        memcpy(x->data, r, k * sizeof(bi_word_t));
+        __bi_trim(x);
+    }
+
+    // a[i] and b[i] have been read in full, so out[i] can be either
+    bi_copy(x, batch->out[i]);
+}
+
+static void __bi_batch_work(__bi_batch_t *batch) {
+    uint32_t k = batch->mm.k;
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *base = __bi_scratch_alloc(k);
+    bi_word_t *r = __bi_scratch_alloc(2 * (size_t)k + 1);
+    MPI x = bi_init(k);
+
+    uint32_t i;
+    while ((i = atomic_fetch_add(&batch->next, 1u)) < batch->count) {
+        __bi_batch_one(batch, i, base, r, x);
+    }
+
+    bi_free(x);
+    __bi_scratch_release(mark);
+}
+
+// a pool thread, which hands its scratch arena back before it exits
+static void *__bi_batch_thread(void *arg) {
+    __bi_batch_work(arg);
+    bi_scratch_free();
+
+    return NULL;
+}
+
+void bi_mod_exp_batch(MPI *out, MPI *a, MPI *b, MPI e, uint32_t count, MPI n,
+                      uint32_t threads) {
+    if (b == NULL && e == NULL) {
+        printf("ERROR in bi_mod_exp_batch, code: %d", BI_BAD_OPERANDS);
+        exit(1);
+    }
+
+    if (bi_eq_val(n, 1u)) {
+        for (uint32_t i = 0; i < count; i++) {
+            bi_set(out[i], 0u);
+        }
+        return;
+    }
+
+    __bi_batch_t batch = {
+        .out = out,
+        .a = a,
+        .b = b,
+        .e = e,
+        .count = count,
+        .odd = !bi_even(n),
+    };
+    atomic_init(&batch.next, 0u);
+
+    if (batch.odd) {
+        bi_mont_init(&batch.mont, n);
+        batch.ifma = __bi_mont_ifma(&batch.mont);
+        batch.mm = __bi_mont_modmul(&batch.mont, batch.ifma);
+    } else {
+        bi_barrett_init(&batch.barrett, n);
+        batch.mm = __bi_barrett_modmul(&batch.barrett);
+    }
+
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (uint32_t)cpus : 1u;
+    }
+    if (threads > count) {
+        threads = count;
+    }
+    if (threads > BI_BATCH_MAX_THREADS) {
+        threads = BI_BATCH_MAX_THREADS;
+    }
+
+    // the calling thread is one of the workers. If a thread can't be
+    // started, the rest pick up its share.
+    pthread_t workers[BI_BATCH_MAX_THREADS];
+    uint32_t started = 0;
+    while (started + 1 < threads &&
+           pthread_create(&workers[started], NULL, __bi_batch_thread,
+                          &batch) == 0) {
+        started++;
+    }
+
+    __bi_batch_work(&batch);
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    if (batch.odd) {
+        free(batch.ifma);
+        bi_mont_free(&batch.mont);
+    } else {
+        bi_barrett_free(&batch.barrett);
+    }
+}
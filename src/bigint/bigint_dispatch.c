@@ -0,0 +1,119 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+/*
+ * Picks the kernels for the CPU we're running on. Everything starts out bound
+ * to the generic C versions, and the constructor below swaps in faster ones
+ * once, before main, so the hot paths only pay for an indirect call.
+ */
+
+__bi_kernels_t __bi_kernels = {
+    .cpu = 0,
+    .mul_1 = __bi_mul_1,
+    .addmul_1 = __bi_addmul_1,
+    .submul_1 = __bi_submul_1,
+};
+
+// Tiers that BIGINT_CPU can ask for, each with every feature of those below
+static const struct {
+    const char *name;
+    uint32_t cpu;
+} __bi_cpu_tiers[] = {
+    {"generic", 0},
+    {"adx", BI_CPU_BMI2 | BI_CPU_ADX},
+    {"avx2", BI_CPU_BMI2 | BI_CPU_ADX | BI_CPU_AVX2},
+    {"ifma", BI_CPU_BMI2 | BI_CPU_ADX | BI_CPU_AVX2 | BI_CPU_AVX512_IFMA},
+};
+
+#define BI_CPU_TIERS (sizeof(__bi_cpu_tiers) / sizeof(*__bi_cpu_tiers))
+
+static uint32_t __bi_cpu_probe(void) {
+    uint32_t cpu = 0;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+
+    // the OS has to save the vector registers for us to use them
+    uint64_t xcr0 = 0;
+    if (ecx & bit_OSXSAVE) {
+        uint32_t lo, hi;
+        __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = ((uint64_t)hi << 32) | lo;
+    }
+    bool ymm = (xcr0 & 0x06) == 0x06;
+    bool zmm = ymm && (xcr0 & 0xe0) == 0xe0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+
+    if (ebx & bit_BMI2) {
+        cpu |= BI_CPU_BMI2;
+    }
+    if (ebx & bit_ADX) {
+        cpu |= BI_CPU_ADX;
+    }
+    if (ymm && (ebx & bit_AVX2)) {
+        cpu |= BI_CPU_AVX2;
+    }
+    if (zmm && (ebx & bit_AVX512F) && (ebx & bit_AVX512IFMA)) {
+        cpu |= BI_CPU_AVX512_IFMA;
+    }
+#endif
+
+    return cpu;
+}
+
+__attribute__((constructor)) static void __bi_dispatch_init(void) {
+    uint32_t cpu = __bi_cpu_probe();
+
+    const char *tier = getenv("BIGINT_CPU");
+    if (tier != NULL) {
+        uint32_t i = 0;
+        while (i < BI_CPU_TIERS && strcmp(tier, __bi_cpu_tiers[i].name) != 0) {
+            i++;
+        }
+
+        if (i < BI_CPU_TIERS) {
+            // can only take features away, never add ones the CPU lacks
+            cpu &= __bi_cpu_tiers[i].cpu;
+        } else {
+            fprintf(stderr, "WARNING: unknown BIGINT_CPU tier %s, ignoring\n",
+                    tier);
+        }
+    }
+
+    __bi_kernels.cpu = cpu;
+
+#ifdef BI_HAVE_ADX
+    if ((cpu & (BI_CPU_BMI2 | BI_CPU_ADX)) == (BI_CPU_BMI2 | BI_CPU_ADX)) {
+        __bi_kernels.mul_1 = __bi_mul_1_adx;
+        __bi_kernels.addmul_1 = __bi_addmul_1_adx;
+        __bi_kernels.submul_1 = __bi_submul_1_adx;
+    }
+#endif
+}
+
+const char *bi_kernel_tier(void) {
+    // the highest tier we have every feature of
+    uint32_t i = BI_CPU_TIERS - 1;
+    while (i > 0 && (__bi_kernels.cpu & __bi_cpu_tiers[i].cpu) !=
+                        __bi_cpu_tiers[i].cpu) {
+        i--;
+    }
+
+    return __bi_cpu_tiers[i].name;
+}
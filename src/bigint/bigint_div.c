@@ -0,0 +1,329 @@
+#include <bigint/bigint.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+bi_word_t __bi_div_reciprocal(bi_word_t d1, bi_word_t d0) {
+    // floor((B^2 - 1) / d1) - B, the reciprocal of d1 alone
+    bi_word_t v = (bi_word_t)(~(bi_dword_t)0 / d1);
+
+    // then stepped down for d0, as in Moller and Granlund, "Improved
+    // division by invariant integers" (2011), algorithm 6
+    bi_word_t p = d1 * v + d0;
+    if (p < d0) {
+        v--;
+        if (p >= d1) {
+            v--;
+            p -= d1;
+        }
+        p -= d1;
+    }
+
+    bi_dword_t t = (bi_dword_t)d0 * v;
+    bi_word_t t1 = (bi_word_t)(t >> BI_WORD_BITS);
+    bi_word_t t0 = (bi_word_t)t;
+    p += t1;
+    if (p < t1) {
+        v--;
+        if (p > d1 || (p == d1 && t0 >= d0)) {
+            v--;
+        }
+    }
+
+    return v;
+}
+
+// The quotient of n2 n1 n0 by d1 d0, where n2 n1 < d1 d0, with the remainder
+// left in r. One multiplication gives an estimate that's at most one out
+// either way, and the correction is mostly branch free (algorithm 5 of the
+// same paper).
+static inline bi_word_t __bi_div_3by2(bi_dword_t *r, bi_word_t n2,
+                                      bi_word_t n1, bi_word_t n0,
+                                      bi_word_t d1, bi_word_t d0,
+                                      bi_word_t d_inv) {
+    bi_dword_t d = (bi_dword_t)d1 << BI_WORD_BITS | d0;
+    bi_dword_t q =
+        (bi_dword_t)n2 * d_inv + ((bi_dword_t)n2 << BI_WORD_BITS | n1);
+    bi_word_t q1 = (bi_word_t)(q >> BI_WORD_BITS);
+    bi_word_t q0 = (bi_word_t)q;
+
+    // the top two words of n - (q1 + 1) * d, all mod B^2
+    bi_word_t t = n1 - d1 * q1;
+    bi_dword_t rem = ((bi_dword_t)t << BI_WORD_BITS | n0) - d -
+                     (bi_dword_t)d0 * q1;
+    q1++;
+
+    bi_dword_t mask =
+        (bi_dword_t)0 - ((bi_word_t)(rem >> BI_WORD_BITS) >= q0);
+    q1 += (bi_word_t)mask;
+    rem += d & mask;
+
+    if (rem >= d) {
+        q1++;
+        rem -= d;
+    }
+
+    *r = rem;
+    return q1;
+}
+
+// Steps D2 to D7 of Knuth D, with each quotient word taken from the top
+// three words of the window by __bi_div_3by2 rather than estimated from the
+// top two and corrected. The estimate is exact for those three words, so
+// it's at most one too big for the whole window.
+static void __bi_div_knuth(bi_word_t *q, bi_word_t *U, uint32_t m,
+                           const bi_word_t *V, uint32_t n, bi_word_t d_inv) {
+    bi_word_t d1 = V[n - 1];
+    bi_word_t d0 = V[n - 2];
+
+    for (int32_t j = m - n; j >= 0; j--) {
+        bi_word_t *W = U + j;
+        bi_word_t q_j;
+
+        if (W[n] == d1 && W[n - 1] == d0) {
+            // the window is below V * B, so the quotient is B - 1, and the
+            // borrow out of the subtraction takes W[n] to zero
+            q_j = BI_WORD_MAX;
+            __bi_kernels.submul_1(W, V, n, q_j);
+        } else {
+            // D3, and D4 for all but the top two words of V, which the
+            // remainder of the three word division already accounts for
+            bi_dword_t rem;
+            q_j = __bi_div_3by2(&rem, W[n], W[n - 1], W[n - 2], d1, d0,
+                                d_inv);
+            bi_word_t borrow = __bi_kernels.submul_1(W, V, n - 2, q_j);
+
+            bi_word_t r0 = (bi_word_t)rem;
+            bi_word_t r1 = (bi_word_t)(rem >> BI_WORD_BITS);
+            bi_word_t b0 = r0 < borrow;
+            W[n - 2] = r0 - borrow;
+            bi_word_t b1 = r1 < b0;
+            W[n - 1] = r1 - b0;
+
+            // D5/D6: a borrow out of the top means q_j was one too big. The
+            // carry out of adding V back cancels it.
+            if (b1) {
+                q_j--;
+                __bi_add_words(W, W, n, V, n);
+            }
+        }
+
+        W[n] = 0;
+        if (q) {
+            q[j] = q_j;
+        }
+    }
+}
+
+/*
+ * Burnikel-Ziegler recursive division ("Fast Recursive Division", 1998).
+ * Dividing a 2n word number by an n word one is split into two divisions of
+ * 3n/2 words by n, and each of those into one 2n/2 by n/2 division of the
+ * top halves plus a multiplication to correct for the low half of the
+ * divisor. The multiplications go through __bi_mul_words, so the division
+ * costs a small multiple of a Karatsuba / Toom-3 / NTT product instead of
+ * Knuth D's n^2.
+ *
+ * Everything here works in place on normalised operands: the divisor's top
+ * bit is set, and each partial dividend is below the divisor times the power
+ * of B its quotient covers, so the quotient always fits.
+ */
+
+static void __bi_div_step(bi_word_t *q, bi_word_t *A, uint32_t h,
+                          const bi_word_t *V, uint32_t n);
+
+// q = A / V, for V of n words and A of 2n words below V * B^n. q has n words
+// and the remainder replaces the low n words of A.
+static void __bi_div_2n_1n(bi_word_t *q, bi_word_t *A, const bi_word_t *V,
+                           uint32_t n) {
+    if (n == 1) {
+        bi_dword_t a = (bi_dword_t)A[1] << BI_WORD_BITS | A[0];
+        q[0] = (bi_word_t)(a / V[0]);
+        A[0] = (bi_word_t)(a % V[0]);
+        return;
+    }
+
+    if (n < BI_BZ_THRESHOLD) {
+        // A's top n words are below V, so Knuth D can run on it as is
+        __bi_div_knuth(q, A, 2 * n - 1, V, n,
+                       __bi_div_reciprocal(V[n - 1], V[n - 2]));
+        return;
+    }
+
+    // the top hi quotient words, leaving a remainder of n words that the
+    // low lo words of A extend to the second division
+    uint32_t lo = n / 2;
+    uint32_t hi = n - lo;
+    __bi_div_step(q + lo, A + lo, hi, V, n);
+    __bi_div_step(q, A, lo, V, n);
+}
+
+// q = A / V, for V of n words, h < n and A of n + h words below V * B^h. q
+// has h words and the remainder replaces the low n words of A.
+static void __bi_div_step(bi_word_t *q, bi_word_t *A, uint32_t h,
+                          const bi_word_t *V, uint32_t n) {
+    const bi_word_t *V1 = V + n - h;
+    bi_word_t *A1 = A + n;
+
+    // estimate the quotient from the top h words of V. That ignores the
+    // rest of V, but as V1 is normalised and as long as q, the estimate is
+    // at most 2 too big.
+    bi_word_t top;
+    int32_t i = h - 1;
+    while (i >= 0 && A1[i] == V1[i]) {
+        i--;
+    }
+
+    if (i >= 0 && A1[i] < V1[i]) {
+        // A's top 2h words by V1, with the remainder left in A[n - h, n)
+        __bi_div_2n_1n(q, A + n - h, V1, h);
+        top = 0;
+    } else {
+        // A1 = V1, so the quotient is B^h - 1 at most, and the remainder of
+        // the top 2h words by V1 is A[n - h, n) - (B^h - 1) * V1 + V1 * B^h
+        memset(q, 0xff, (size_t)h * sizeof(bi_word_t));
+        top = __bi_add_words(A + n - h, A + n - h, h, V1, h);
+    }
+
+    // subtract q times the low n - h words of V from the n word remainder,
+    // adding V back while it's negative
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *t = __bi_scratch_alloc(n);
+    __bi_mul_words(t, q, h, V, n - h);
+    bi_word_t borrow = __bi_sub_words(A, A, n, t, n);
+    __bi_scratch_release(mark);
+
+    while (top < borrow) {
+        for (uint32_t j = 0; q[j]-- == 0; j++) {
+        }
+        top += __bi_add_words(A, A, n, V, n);
+    }
+}
+
+static void __bi_div_bz(bi_word_t *q, bi_word_t *U, uint32_t m,
+                        const bi_word_t *V, uint32_t n) {
+    size_t mark = __bi_scratch_mark();
+    uint32_t qn = m - n + 1;
+    if (!q) {
+        q = __bi_scratch_alloc(qn);
+    }
+
+    // The top n words of U are below V. Bring down up to n words at a time
+    // and divide, keeping the remainder in place above the next chunk.
+    while (qn > 0) {
+        uint32_t h = qn < n ? qn : n;
+        qn -= h;
+
+        if (h == n) {
+            __bi_div_2n_1n(q + qn, U + qn, V, n);
+        } else {
+            __bi_div_step(q + qn, U + qn, h, V, n);
+        }
+    }
+
+    U[n] = 0;
+    __bi_scratch_release(mark);
+}
+
+void __bi_div_norm(bi_word_t *q, bi_word_t *U, uint32_t m, const bi_word_t *V,
+                   uint32_t n, bi_word_t d_inv) {
+    if (n >= BI_BZ_THRESHOLD && m - n >= BI_BZ_THRESHOLD) {
+        __bi_div_bz(q, U, m, V, n);
+    } else {
+        __bi_div_knuth(q, U, m, V, n, d_inv);
+    }
+}
+
+void bi_div_init(bi_div_ctx_t *ctx, MPI d) {
+    if (bi_eq_val(d, 0)) {
+        printf("ERROR in bi_div_init, code: %d", BI_DIV_ZERO);
+        exit(1);
+    }
+
+    ctx->d = bi_init_and_copy(d);
+    bi_squeeze(ctx->d);
+
+    uint32_t k = ctx->d->words;
+    bi_word_t *v = ctx->d->data;
+    ctx->shift = __bi_clz(v[k - 1]);
+    __bi_shl_bits(v, v, k, ctx->shift);
+    ctx->d_inv = k > 1 ? __bi_div_reciprocal(v[k - 1], v[k - 2]) : 0;
+}
+
+void bi_div_free(bi_div_ctx_t *ctx) { bi_free(ctx->d); }
+
+void bi_div_qr_into(MPI q, MPI r, MPI u, bi_div_ctx_t *ctx) {
+    uint32_t k = ctx->d->words;
+    const bi_word_t *v = ctx->d->data;
+
+    uint32_t m = u->words;
+    while (m > 1 && u->data[m - 1] == 0) {
+        m--;
+    }
+
+    if (m < k) {
+        // the divisor's top word is non-zero, so u is below it
+        if (r && r != u) {
+            __bi_resize(r, m);
+            memcpy(r->data, u->data, (size_t)m * sizeof(bi_word_t));
+        }
+        if (q) {
+            __bi_resize(q, 1);
+            q->data[0] = 0;
+        }
+        if (r) {
+            __bi_trim(r);
+        }
+        return;
+    }
+
+    if (k == 1) {
+        bi_word_t d = v[0] >> ctx->shift;
+        if (q) {
+            __bi_resize(q, m);
+        }
+        __bi_div_words(q ? q->data : NULL, r ? r->data : NULL, u->data, m,
+                       &d, 1);
+        if (r) {
+            __bi_resize(r, 1);
+        }
+    } else {
+        // shift u the same as the divisor. q and r are only resized after
+        // it's been copied out, in case either is u.
+        size_t mark = __bi_scratch_mark();
+        bi_word_t *U = __bi_scratch_alloc(m + 1);
+        U[m] = __bi_shl_bits(U, u->data, m, ctx->shift);
+
+        if (q) {
+            __bi_resize(q, m - k + 1);
+        }
+        __bi_div_norm(q ? q->data : NULL, U, m, v, k, ctx->d_inv);
+
+        if (r) {
+            __bi_resize(r, k);
+            __bi_div_unnorm(r->data, U, k, ctx->shift);
+        }
+        __bi_scratch_release(mark);
+    }
+
+    if (q) {
+        __bi_trim(q);
+    }
+    if (r) {
+        __bi_trim(r);
+    }
+}
+
+void bi_div_mod_into(MPI r, MPI u, bi_div_ctx_t *ctx) {
+    bi_div_qr_into(NULL, r, u, ctx);
+}
+
+MPI bi_div_mod(MPI u, bi_div_ctx_t *ctx) {
+    MPI res = bi_init(ctx->d->words);
+    bi_div_qr_into(NULL, res, u, ctx);
+
+    return res;
+}
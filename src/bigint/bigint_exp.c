@@ -0,0 +1,395 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+// Window size for sliding window exponentiation, picked by exponent length.
+// Bigger windows need 2^(w-1) precomputed powers, but save multiplications
+// once the exponent is long enough to amortise the table.
+static uint32_t __bi_window_bits(uint32_t exp_bits) {
+    if (exp_bits > 671) {
+        return 6;
+    } else if (exp_bits > 239) {
+        return 5;
+    } else if (exp_bits > 79) {
+        return 4;
+    } else if (exp_bits > 23) {
+        return 3;
+    }
+
+    return 1;
+}
+
+// table[i] = base^(2i + 1) for i < size. t is mm's scratch space.
+static void __bi_odd_powers(bi_word_t *table, const bi_word_t *base,
+                            uint32_t size, bi_word_t *t,
+                            const __bi_modmul_t *mm) {
+    uint32_t k = mm->k;
+
+    memcpy(table, base, k * sizeof(bi_word_t));
+    if (size > 1) {
+        size_t mark = __bi_scratch_mark();
+        bi_word_t *base_sq = __bi_scratch_alloc(k);
+
+        mm->sqr(base_sq, table, t, mm->ctx);
+        for (uint32_t i = 1; i < size; i++) {
+            mm->mul(table + i * k, table + (i - 1) * k, base_sq, t, mm->ctx);
+        }
+        __bi_scratch_release(mark);
+    }
+}
+
+// The longest window of at most w bits of e with its top bit at i, which is
+// set, and ending in a set bit. Gives its value and leaves its bottom bit in
+// j.
+static uint32_t __bi_window_at(MPI e, int32_t i, uint32_t w, int32_t *j) {
+    int32_t lo = i - (int32_t)w + 1 < 0 ? 0 : i - (int32_t)w + 1;
+    while (!bi_test_bit(e, lo)) {
+        lo++;
+    }
+
+    uint32_t value = 0;
+    for (int32_t l = i; l >= lo; l--) {
+        value = (value << 1) | bi_test_bit(e, l);
+    }
+
+    *j = lo;
+    return value;
+}
+
+void __bi_window_exp(bi_word_t *r, const bi_word_t *base, MPI e,
+                     const __bi_modmul_t *mm) {
+    uint32_t k = mm->k;
+    uint32_t exp_bits = bi_bit_length(e);
+    uint32_t w = __bi_window_bits(exp_bits);
+    uint32_t table_size = 1u << (w - 1);
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *table = __bi_scratch_alloc((size_t)table_size * k);
+    bi_word_t *t = __bi_scratch_alloc(mm->scratch_words);
+    __bi_odd_powers(table, base, table_size, t, mm);
+
+    // left to right sliding window over the bits of e. The first window
+    // seeds r directly, so we never square a 1.
+    bool started = false;
+    int32_t i = exp_bits - 1;
+    while (i >= 0) {
+        if (!bi_test_bit(e, i)) {
+            mm->sqr(r, r, t, mm->ctx);
+            i--;
+            continue;
+        }
+
+        int32_t j;
+        uint32_t value = __bi_window_at(e, i, w, &j);
+
+        if (started) {
+            for (int32_t l = i; l >= j; l--) {
+                mm->sqr(r, r, t, mm->ctx);
+            }
+            mm->mul(r, r, table + (value >> 1) * k, t, mm->ctx);
+        } else {
+            memcpy(r, table + (value >> 1) * k, k * sizeof(bi_word_t));
+            started = true;
+        }
+
+        i = j - 1;
+    }
+
+    __bi_scratch_release(mark);
+}
+
+// Where one exponent's sliding window has got to in __bi_multi_exp
+typedef struct {
+    MPI e;
+    const bi_word_t *table; // base^(2i + 1)
+    uint32_t w;
+    int32_t next;   // the next bit a window can start at
+    int32_t end;    // bottom bit of the window under way, or -1
+    uint32_t value; // and its value
+} __bi_multi_window_t;
+
+void __bi_multi_exp(bi_word_t *r, const bi_word_t *one,
+                    const bi_word_t *bases, MPI *exps, uint32_t count,
+                    const __bi_modmul_t *mm) {
+    uint32_t k = mm->k;
+    __bi_multi_window_t *win = malloc((size_t)count * sizeof(*win));
+    if (count > 0 && win == NULL) {
+        fprintf(stderr, "FATAL: out of memory in __bi_multi_exp\n");
+        exit(1);
+    }
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *t = __bi_scratch_alloc(mm->scratch_words);
+
+    // each base gets the odd powers table __bi_window_exp would give it
+    uint32_t top = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t exp_bits = bi_bit_length(exps[i]);
+        uint32_t w = __bi_window_bits(exp_bits);
+        uint32_t table_size = 1u << (w - 1);
+        bi_word_t *table = __bi_scratch_alloc((size_t)table_size * k);
+        __bi_odd_powers(table, bases + (size_t)i * k, table_size, t, mm);
+
+        win[i] = (__bi_multi_window_t){
+            .e = exps[i],
+            .table = table,
+            .w = w,
+            .next = (int32_t)exp_bits - 1,
+            .end = -1,
+        };
+        top = exp_bits > top ? exp_bits : top;
+    }
+
+    // one squaring per bit for all of the exponents. Each window is
+    // multiplied in at its bottom bit, so it's squared up the rest of the
+    // way along with everything else.
+    bool started = false;
+    for (int32_t b = (int32_t)top - 1; b >= 0; b--) {
+        if (started) {
+            mm->sqr(r, r, t, mm->ctx);
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            __bi_multi_window_t *x = &win[i];
+            if (x->next == b) {
+                if (bi_test_bit(x->e, b)) {
+                    x->value = __bi_window_at(x->e, b, x->w, &x->end);
+                    x->next = x->end - 1;
+                } else {
+                    x->next--;
+                }
+            }
+
+            if (x->end != b) {
+                continue;
+            }
+
+            const bi_word_t *entry = x->table + (x->value >> 1) * k;
+            if (started) {
+                mm->mul(r, r, entry, t, mm->ctx);
+            } else {
+                memcpy(r, entry, k * sizeof(bi_word_t));
+                started = true;
+            }
+            x->end = -1;
+        }
+    }
+
+    if (!started) {
+        memcpy(r, one, k * sizeof(bi_word_t));
+    }
+
+    __bi_scratch_release(mark);
+    free(win);
+}
+
+// all ones if a == b, else zero
+static bi_word_t __bi_ct_eq(bi_word_t a, bi_word_t b) {
+    bi_word_t x = a ^ b;
+
+    // the top bit of x | -x is set exactly when x is nonzero
+    return ((x | ((bi_word_t)0 - x)) >> (BI_WORD_BITS - 1)) - 1u;
+}
+
+// r = table[idx], reading every entry so the index can't be seen in which
+// cache lines were touched. r is outside the table, and saying so lets the
+// compiler vectorise the scan.
+static void __bi_ct_select(bi_word_t *restrict r,
+                           const bi_word_t *restrict table, uint32_t entries,
+                           bi_word_t idx, uint32_t k) {
+    memset(r, 0, k * sizeof(bi_word_t));
+
+    for (uint32_t i = 0; i < entries; i++) {
+        bi_word_t mask = __bi_ct_eq(i, idx);
+        for (uint32_t j = 0; j < k; j++) {
+            r[j] |= table[i * k + j] & mask;
+        }
+    }
+}
+
+// __bi_ct_select, or the backend's own version of it
+static void __bi_ct_lookup(bi_word_t *r, const bi_word_t *table,
+                           uint32_t entries, bi_word_t idx,
+                           const __bi_modmul_t *mm) {
+    if (mm->select) {
+        mm->select(r, table, entries, idx, mm->ctx);
+    } else {
+        __bi_ct_select(r, table, entries, idx, mm->k);
+    }
+}
+
+// the w bits of e starting at bit lo, where e has words words
+static bi_word_t __bi_ct_window(const bi_word_t *e, uint32_t words,
+                                uint32_t lo, uint32_t w) {
+    uint32_t word = lo / BI_WORD_BITS;
+    uint32_t offset = lo % BI_WORD_BITS;
+
+    bi_word_t v = e[word] >> offset;
+    if (offset + w > BI_WORD_BITS && word + 1 < words) {
+        v |= e[word + 1] << (BI_WORD_BITS - offset);
+    }
+
+    return v & (((bi_word_t)1 << w) - 1);
+}
+
+// Fixed window size for __bi_window_exp_ct. Every window costs a table scan
+// of 2^w entries as well as the multiply, so this tops out lower than the
+// sliding window sizes.
+static uint32_t __bi_ct_window_bits(uint32_t exp_bits) {
+    if (exp_bits > 1536) {
+        return 6;
+    } else if (exp_bits > 768) {
+        return 5;
+    } else if (exp_bits > 128) {
+        return 4;
+    }
+
+    return 3;
+}
+
+void __bi_window_exp_ct(bi_word_t *r, const bi_word_t *one,
+                        const bi_word_t *base, MPI e, const __bi_modmul_t *mm) {
+    uint32_t k = mm->k;
+
+    // every bit of every word of e is walked, set or not
+    uint32_t exp_bits = e->words * BI_WORD_BITS;
+    uint32_t w = __bi_ct_window_bits(exp_bits);
+    uint32_t entries = 1u << w;
+
+    // table[i] = base^i
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *table = __bi_scratch_alloc((size_t)entries * k);
+    bi_word_t *sel = __bi_scratch_alloc(k);
+    bi_word_t *t = __bi_scratch_alloc(mm->scratch_words);
+
+    memcpy(table, one, k * sizeof(bi_word_t));
+    memcpy(table + k, base, k * sizeof(bi_word_t));
+    for (uint32_t i = 2; i < entries; i++) {
+        mm->mul(table + i * k, table + (i - 1) * k, base, t, mm->ctx);
+    }
+
+    // left to right over fixed windows, with the top one possibly short.
+    // Zero windows still multiply, by table[0].
+    uint32_t windows = (exp_bits + w - 1) / w;
+    __bi_ct_lookup(r, table, entries,
+                   __bi_ct_window(e->data, e->words, (windows - 1) * w, w), mm);
+
+    for (uint32_t i = windows - 1; i-- > 0;) {
+        for (uint32_t j = 0; j < w; j++) {
+            mm->sqr(r, r, t, mm->ctx);
+        }
+
+        __bi_ct_lookup(sel, table, entries,
+                       __bi_ct_window(e->data, e->words, i * w, w), mm);
+        mm->mul(r, r, sel, t, mm->ctx);
+    }
+
+    __bi_scratch_release(mark);
+}
+
+void __bi_comb_build(bi_word_t *table, const bi_word_t *one,
+                     const bi_word_t *base, uint32_t teeth, uint32_t spacing,
+                     const __bi_modmul_t *mm) {
+    uint32_t k = mm->k;
+    uint32_t entries = 1u << teeth;
+    uint32_t block = (spacing + BI_COMB_TABLES - 1) / BI_COMB_TABLES;
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *g = __bi_scratch_alloc((size_t)teeth * k);
+    bi_word_t *t = __bi_scratch_alloc(mm->scratch_words);
+
+    // g[i] = base^(2^(i * spacing)), one per tooth
+    memcpy(g, base, k * sizeof(bi_word_t));
+    for (uint32_t i = 1; i < teeth; i++) {
+        bi_word_t *gi = g + (size_t)i * k;
+        memcpy(gi, gi - k, k * sizeof(bi_word_t));
+        for (uint32_t j = 0; j < spacing; j++) {
+            mm->sqr(gi, gi, t, mm->ctx);
+        }
+    }
+
+    for (uint32_t s = 0; s < BI_COMB_TABLES; s++) {
+        bi_word_t *tab = table + (size_t)s * entries * k;
+
+        // each table after the first is a block of squarings further up
+        if (s > 0) {
+            for (uint32_t i = 0; i < teeth; i++) {
+                for (uint32_t j = 0; j < block; j++) {
+                    mm->sqr(g + (size_t)i * k, g + (size_t)i * k, t, mm->ctx);
+                }
+            }
+        }
+
+        // tab[x] is the product of g[i] over the bits i set in x, built up
+        // from the entry without x's top bit
+        memcpy(tab, one, k * sizeof(bi_word_t));
+        for (uint32_t x = 1; x < entries; x++) {
+            uint32_t top = BI_WORD_BITS - 1 - __bi_clz(x);
+            bi_word_t *gt = g + (size_t)top * k;
+
+            if (x == 1u << top) {
+                memcpy(tab + (size_t)x * k, gt, k * sizeof(bi_word_t));
+            } else {
+                mm->mul(tab + (size_t)x * k,
+                        tab + (size_t)(x ^ 1u << top) * k, gt, t, mm->ctx);
+            }
+        }
+    }
+
+    __bi_scratch_release(mark);
+}
+
+void __bi_comb_exp(bi_word_t *r, const bi_word_t *one, const bi_word_t *table,
+                   uint32_t teeth, uint32_t spacing, MPI e,
+                   const __bi_modmul_t *mm) {
+    uint32_t k = mm->k;
+    uint32_t entries = 1u << teeth;
+    uint32_t block = (spacing + BI_COMB_TABLES - 1) / BI_COMB_TABLES;
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *t = __bi_scratch_alloc(mm->scratch_words);
+
+    // one squaring per column of a block, and a multiplication for each
+    // table whose column has any bits set. As with the sliding window, the
+    // first entry seeds r so we never square a 1.
+    bool started = false;
+    for (uint32_t j = block; j-- > 0;) {
+        if (started) {
+            mm->sqr(r, r, t, mm->ctx);
+        }
+
+        for (uint32_t s = 0; s < BI_COMB_TABLES; s++) {
+            uint32_t col = s * block + j;
+            if (col >= spacing) {
+                continue;
+            }
+
+            uint32_t idx = 0;
+            for (uint32_t i = teeth; i-- > 0;) {
+                idx = (idx << 1) | bi_test_bit(e, i * spacing + col);
+            }
+            if (idx == 0) {
+                continue;
+            }
+
+            const bi_word_t *entry = table + ((size_t)s * entries + idx) * k;
+            if (started) {
+                mm->mul(r, r, entry, t, mm->ctx);
+            } else {
+                memcpy(r, entry, k * sizeof(bi_word_t));
+                started = true;
+            }
+        }
+    }
+
+    if (!started) {
+        memcpy(r, one, k * sizeof(bi_word_t));
+    }
+
+    __bi_scratch_release(mark);
+}
@@ -0,0 +1,549 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+/*
+ * Lehmer's extended GCD (Knuth, TAOCP vol. 2, 4.5.2 algorithm L). The
+ * Euclidean quotients mostly depend only on the leading bits of the
+ * remainders, so runs of them are found from double word approximations of
+ * the top bits, and collected into a 2x2 matrix of single word entries. Each
+ * run is then applied to the full remainders and cofactors at once with row
+ * kernels, which advances them by about a word per pass instead of a bit.
+ *
+ * The cofactors of a alternate in sign along the remainder sequence, so only
+ * their magnitudes are kept, and the matrix only ever adds them.
+ */
+
+// Bits of the approximations. Two short of a double word keeps the bounds
+// x + A and friends below in a signed double word.
+#define BI_LEHMER_BITS (2 * BI_WORD_BITS - 2)
+
+static void __bi_swap(MPI *a, MPI *b) {
+    MPI t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// The double word of x's bits from bit lo up, where x has n words and is zero
+// past them. Which words are read only depends on lo and n.
+static bi_sdword_t __bi_get_bits(const bi_word_t *x, uint32_t n,
+                                 uint32_t lo) {
+    uint32_t w = lo / BI_WORD_BITS;
+    uint32_t s = lo % BI_WORD_BITS;
+
+    bi_dword_t r = 0;
+    for (uint32_t i = 0; i < 3 && w + i < n; i++) {
+        int32_t sh = (int32_t)(i * BI_WORD_BITS) - (int32_t)s;
+        if (sh < 0) {
+            r |= (bi_dword_t)(x[w + i] >> -sh);
+        } else if (sh < 2 * BI_WORD_BITS) {
+            r |= (bi_dword_t)x[w + i] << sh;
+        }
+    }
+
+    return (bi_sdword_t)r;
+}
+
+// x / y for x >= 0 and y > 0. Most Euclidean quotients are below 4, and
+// subtracting is much cheaper than a double word divide for those.
+static inline bi_sdword_t __bi_lehmer_quot(bi_sdword_t x, bi_sdword_t y) {
+    if ((x >> 2) >= y) {
+        return x / y;
+    }
+
+    bi_sdword_t q = 0;
+    while (x >= y) {
+        x -= y;
+        q++;
+    }
+
+    return q;
+}
+
+static bi_word_t __bi_lehmer_abs(bi_sdword_t x) {
+    return (bi_word_t)(x < 0 ? -x : x);
+}
+
+// r = x * a - y * b over n words, for a result known to be in [0, B^n)
+static void __bi_lehmer_diff(bi_word_t *r, const bi_word_t *x, bi_word_t a,
+                             const bi_word_t *y, bi_word_t b, uint32_t n) {
+    __bi_kernels.mul_1(r, x, n, a);
+    __bi_kernels.submul_1(r, y, n, b);
+}
+
+// r = x * a + y * b, where x and y have n words and r has n + 2
+static void __bi_lehmer_sum(bi_word_t *r, const bi_word_t *x, bi_word_t a,
+                            const bi_word_t *y, bi_word_t b, uint32_t n) {
+    bi_dword_t top = __bi_kernels.mul_1(r, x, n, a);
+    top += __bi_kernels.addmul_1(r, y, n, b);
+    r[n] = (bi_word_t)top;
+    r[n + 1] = (bi_word_t)(top >> BI_WORD_BITS);
+}
+
+void __bi_gcdext(MPI g, MPI s, bool *s_neg, MPI a, MPI b) {
+    MPI u = bi_init_and_copy(a);
+    MPI v = bi_init_and_copy(b);
+    MPI tu = bi_init(1);
+    MPI tv = bi_init(1);
+    MPI q = bi_init(1);
+    __bi_trim(u);
+    __bi_trim(v);
+
+    // s0 * a = u and s1 * a = v mod b, with s0 negative when i is odd and
+    // s1 the other way round
+    MPI s0 = bi_init(1);
+    MPI s1 = bi_init(1);
+    MPI t0 = bi_init(1);
+    MPI t1 = bi_init(1);
+    bi_set(s0, 1);
+    uint32_t i = 0;
+
+    // start from u >= v. If a < b the first quotient is 0, which just swaps
+    // them.
+    if (bi_lt(u, v)) {
+        __bi_swap(&u, &v);
+        __bi_swap(&s0, &s1);
+        i = 1;
+    }
+
+    while (!bi_eq_val(v, 0)) {
+        uint32_t n = u->words;
+        uint32_t bits = bi_bit_length(u);
+        uint32_t lo = bits > BI_LEHMER_BITS ? bits - BI_LEHMER_BITS : 0;
+
+        // v <= u, so pad it to the same length
+        __bi_resize(v, n);
+        bi_sdword_t x = __bi_get_bits(u->data, n, lo);
+        bi_sdword_t y = __bi_get_bits(v->data, n, lo);
+
+        // The true remainders over 2^lo lie between x + B and x + A, and
+        // between y + C and y + D, so while both ends give the same quotient
+        // it's the real one
+        bi_sdword_t A = 1, B = 0, C = 0, D = 1;
+        uint32_t k = 0;
+        for (;;) {
+            bi_sdword_t xa = x + A, xb = x + B;
+            bi_sdword_t yc = y + C, yd = y + D;
+            if (xa < 0 || xb < 0 || yc <= 0 || yd <= 0) {
+                break;
+            }
+
+            // q from one end, checked against the other by multiplying,
+            // as a divide costs more
+            bi_sdword_t qk = __bi_lehmer_quot(xa, yc);
+            bi_sdword_t qy;
+            if (qk > (bi_sdword_t)BI_WORD_MAX ||
+                __builtin_mul_overflow(qk, yd, &qy) || qy > xb ||
+                xb - qy >= yd) {
+                break;
+            }
+
+            // the next entries have the magnitudes |A| + q|C| and
+            // |B| + q|D|, which have to stay within a word
+            bi_dword_t next_a = __bi_lehmer_abs(A) +
+                                (bi_dword_t)qk * __bi_lehmer_abs(C);
+            bi_dword_t next_b = __bi_lehmer_abs(B) +
+                                (bi_dword_t)qk * __bi_lehmer_abs(D);
+            if (next_a > BI_WORD_MAX || next_b > BI_WORD_MAX) {
+                break;
+            }
+
+            bi_sdword_t t = A - qk * C;
+            A = C;
+            C = t;
+            t = B - qk * D;
+            B = D;
+            D = t;
+            t = x - qk * y;
+            x = y;
+            y = t;
+            k++;
+        }
+
+        if (k == 0) {
+            // the quotient needs more than the leading bits, so take a
+            // whole division step
+            __bi_trim(v);
+            bi_eucl_div_into(q, tu, u, v);
+            __bi_swap(&u, &v);
+            __bi_swap(&v, &tu);
+
+            if (s) {
+                bi_mul_into(t0, q, s1);
+                bi_add_into(t0, t0, s0);
+                __bi_swap(&s0, &s1);
+                __bi_swap(&s1, &t0);
+            }
+
+            i ^= 1;
+            continue;
+        }
+
+        // (u, v) = (A u + B v, C u + D v). A and D have the sign of
+        // (-1)^k, and B and C the other one.
+        bi_word_t a_ = __bi_lehmer_abs(A), b_ = __bi_lehmer_abs(B);
+        bi_word_t c_ = __bi_lehmer_abs(C), d_ = __bi_lehmer_abs(D);
+        __bi_resize(tu, n);
+        __bi_resize(tv, n);
+        if (k % 2 == 0) {
+            __bi_lehmer_diff(tu->data, u->data, a_, v->data, b_, n);
+            __bi_lehmer_diff(tv->data, v->data, d_, u->data, c_, n);
+        } else {
+            __bi_lehmer_diff(tu->data, v->data, b_, u->data, a_, n);
+            __bi_lehmer_diff(tv->data, u->data, c_, v->data, d_, n);
+        }
+        __bi_swap(&u, &tu);
+        __bi_swap(&v, &tv);
+        __bi_trim(u);
+        __bi_trim(v);
+
+        if (s) {
+            uint32_t len = s0->words > s1->words ? s0->words : s1->words;
+            __bi_resize(s0, len);
+            __bi_resize(s1, len);
+            __bi_resize(t0, len + 2);
+            __bi_resize(t1, len + 2);
+            __bi_lehmer_sum(t0->data, s0->data, a_, s1->data, b_, len);
+            __bi_lehmer_sum(t1->data, s0->data, c_, s1->data, d_, len);
+            __bi_swap(&s0, &t0);
+            __bi_swap(&s1, &t1);
+            __bi_trim(s0);
+            __bi_trim(s1);
+        }
+
+        i ^= k & 1;
+    }
+
+    bi_copy(u, g);
+    if (s) {
+        bi_copy(s0, s);
+        *s_neg = (i & 1) && !bi_eq_val(s0, 0);
+    }
+
+    bi_free(u);
+    bi_free(v);
+    bi_free(tu);
+    bi_free(tv);
+    bi_free(q);
+    bi_free(s0);
+    bi_free(s1);
+    bi_free(t0);
+    bi_free(t1);
+}
+
+/*
+ * Constant time modular inverses by safegcd (Bernstein and Yang, "Fast
+ * constant-time gcd computation and modular inversion", 2019), laid out as in
+ * libsecp256k1. A divstep is one step of a binary GCD on (f, g) for odd f:
+ *
+ *   delta > 0 and g odd:  (1 - delta, g, (g - f) / 2)
+ *   otherwise:            (1 + delta, f, (g + (g mod 2) f) / 2)
+ *
+ * Each step only looks at the low bit of g, so BI_DIVSTEP_BITS of them can be
+ * run with masks on the low word of f and g alone, collecting a 2x2 matrix
+ * that's then applied to the full values and to the cofactors in one pass.
+ * The number of divsteps that takes g to zero is bounded by the bit length,
+ * so running that many every time makes the work independent of the values.
+ *
+ * Values are kept in signed limbs of BI_DIVSTEP_BITS bits, which leaves room
+ * for the matrix products and their sums in a signed double word. All but
+ * the top limb are in [0, 2^BI_DIVSTEP_BITS), and the top one has the sign.
+ */
+
+#define BI_DIVSTEP_BITS (BI_WORD_BITS - 2)
+#define BI_DIVSTEP_MASK (((bi_word_t)1 << BI_DIVSTEP_BITS) - 1)
+
+// 2^BI_DIVSTEP_BITS times the divsteps from (f, g) are (u f + v g, q f + r g)
+typedef struct {
+    bi_sword_t u, v, q, r;
+} __bi_divstep_t;
+
+// x^-1 mod 2^w for odd x, by Newton iteration
+static bi_word_t __bi_word_inv(bi_word_t x) {
+    bi_word_t inv = x;
+    for (uint32_t bits = 3; bits < BI_WORD_BITS; bits *= 2) {
+        inv *= 2u - x * inv;
+    }
+
+    return inv;
+}
+
+// Runs BI_DIVSTEP_BITS divsteps on the low bits f and g, which is as many
+// as they're valid for, and returns the new delta. Every step takes both
+// branches and picks with masks.
+static int32_t __bi_divsteps(int32_t delta, bi_word_t f, bi_word_t g,
+                             __bi_divstep_t *t) {
+    bi_word_t u = 1, v = 0, q = 0, r = 1;
+
+    for (uint32_t i = 0; i < BI_DIVSTEP_BITS; i++) {
+        // all ones when delta > 0 and g is odd, in which case (f, g) turns
+        // into (g, -f) so that the other branch finishes the step
+        bi_word_t odd = (bi_word_t)0 - (g & 1);
+        bi_word_t swap = (bi_word_t)(bi_sword_t)(-delta >> 31) & odd;
+        int32_t neg = (int32_t)swap;
+        delta = (delta ^ neg) - neg + 1;
+
+        bi_word_t x = (f ^ g) & swap;
+        f ^= x;
+        g = ((g ^ x) ^ swap) - swap;
+        x = (u ^ q) & swap;
+        u ^= x;
+        q = ((q ^ x) ^ swap) - swap;
+        x = (v ^ r) & swap;
+        v ^= x;
+        r = ((r ^ x) ^ swap) - swap;
+
+        g += f & odd;
+        q += u & odd;
+        r += v & odd;
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+    }
+
+    t->u = (bi_sword_t)u;
+    t->v = (bi_sword_t)v;
+    t->q = (bi_sword_t)q;
+    t->r = (bi_sword_t)r;
+    return delta;
+}
+
+// (f, g) = t (f, g) / 2^BI_DIVSTEP_BITS, where the division is exact
+static void __bi_divstep_fg(bi_sword_t *f, bi_sword_t *g, uint32_t len,
+                            const __bi_divstep_t *t) {
+    bi_sdword_t cf = (bi_sdword_t)t->u * f[0] + (bi_sdword_t)t->v * g[0];
+    bi_sdword_t cg = (bi_sdword_t)t->q * f[0] + (bi_sdword_t)t->r * g[0];
+    cf >>= BI_DIVSTEP_BITS;
+    cg >>= BI_DIVSTEP_BITS;
+
+    for (uint32_t i = 1; i < len; i++) {
+        cf += (bi_sdword_t)t->u * f[i] + (bi_sdword_t)t->v * g[i];
+        cg += (bi_sdword_t)t->q * f[i] + (bi_sdword_t)t->r * g[i];
+        f[i - 1] = (bi_sword_t)((bi_word_t)cf & BI_DIVSTEP_MASK);
+        g[i - 1] = (bi_sword_t)((bi_word_t)cg & BI_DIVSTEP_MASK);
+        cf >>= BI_DIVSTEP_BITS;
+        cg >>= BI_DIVSTEP_BITS;
+    }
+
+    f[len - 1] = (bi_sword_t)cf;
+    g[len - 1] = (bi_sword_t)cg;
+}
+
+// (d, e) = t (d, e) / 2^BI_DIVSTEP_BITS mod m, for odd m with m_inv = m^-1
+// mod 2^w. Multiples of m are added to make the division exact, picked so
+// that d and e stay in (-2m, m).
+static void __bi_divstep_de(bi_sword_t *d, bi_sword_t *e, uint32_t len,
+                            const __bi_divstep_t *t, const bi_sword_t *m,
+                            bi_word_t m_inv) {
+    // start from d + m and e + m for negative d and e, which puts them in
+    // (-m, m)
+    bi_sword_t sd = d[len - 1] >> (BI_WORD_BITS - 1);
+    bi_sword_t se = e[len - 1] >> (BI_WORD_BITS - 1);
+    bi_sword_t md = (t->u & sd) + (t->v & se);
+    bi_sword_t me = (t->q & sd) + (t->r & se);
+
+    bi_sdword_t cd = (bi_sdword_t)t->u * d[0] + (bi_sdword_t)t->v * e[0];
+    bi_sdword_t ce = (bi_sdword_t)t->q * d[0] + (bi_sdword_t)t->r * e[0];
+
+    // then take off what clears the low bits
+    md -= (bi_sword_t)((m_inv * (bi_word_t)cd + (bi_word_t)md) &
+                       BI_DIVSTEP_MASK);
+    me -= (bi_sword_t)((m_inv * (bi_word_t)ce + (bi_word_t)me) &
+                       BI_DIVSTEP_MASK);
+    cd += (bi_sdword_t)m[0] * md;
+    ce += (bi_sdword_t)m[0] * me;
+    cd >>= BI_DIVSTEP_BITS;
+    ce >>= BI_DIVSTEP_BITS;
+
+    for (uint32_t i = 1; i < len; i++) {
+        cd += (bi_sdword_t)t->u * d[i] + (bi_sdword_t)t->v * e[i] +
+              (bi_sdword_t)m[i] * md;
+        ce += (bi_sdword_t)t->q * d[i] + (bi_sdword_t)t->r * e[i] +
+              (bi_sdword_t)m[i] * me;
+        d[i - 1] = (bi_sword_t)((bi_word_t)cd & BI_DIVSTEP_MASK);
+        e[i - 1] = (bi_sword_t)((bi_word_t)ce & BI_DIVSTEP_MASK);
+        cd >>= BI_DIVSTEP_BITS;
+        ce >>= BI_DIVSTEP_BITS;
+    }
+
+    d[len - 1] = (bi_sword_t)cd;
+    e[len - 1] = (bi_sword_t)ce;
+}
+
+// Moves the bits above each limb into the next one up
+static void __bi_divstep_carry(bi_sword_t *d, uint32_t len) {
+    for (uint32_t i = 0; i + 1 < len; i++) {
+        d[i + 1] += d[i] >> BI_DIVSTEP_BITS;
+        d[i] = (bi_sword_t)((bi_word_t)d[i] & BI_DIVSTEP_MASK);
+    }
+}
+
+// d = d mod m, negated first if neg is all ones, for d in (-2m, m)
+static void __bi_divstep_norm(bi_sword_t *d, bi_sword_t neg,
+                              const bi_sword_t *m, uint32_t len) {
+    bi_sword_t add = d[len - 1] >> (BI_WORD_BITS - 1);
+    for (uint32_t i = 0; i < len; i++) {
+        d[i] = ((d[i] + (m[i] & add)) ^ neg) - neg;
+    }
+    __bi_divstep_carry(d, len);
+
+    add = d[len - 1] >> (BI_WORD_BITS - 1);
+    for (uint32_t i = 0; i < len; i++) {
+        d[i] += m[i] & add;
+    }
+    __bi_divstep_carry(d, len);
+}
+
+// The n words x as len limbs
+static void __bi_to_divstep(bi_sword_t *r, uint32_t len, const bi_word_t *x,
+                            uint32_t n) {
+    for (uint32_t i = 0; i < len; i++) {
+        bi_word_t bits = (bi_word_t)__bi_get_bits(x, n, i * BI_DIVSTEP_BITS);
+        r[i] = (bi_sword_t)(bits & BI_DIVSTEP_MASK);
+    }
+}
+
+// The low n words of the non-negative len limbs x
+static void __bi_from_divstep(bi_word_t *r, uint32_t n, const bi_sword_t *x,
+                              uint32_t len) {
+    bi_dword_t acc = 0;
+    uint32_t bits = 0;
+    uint32_t j = 0;
+
+    for (uint32_t i = 0; i < len && j < n; i++) {
+        acc |= (bi_dword_t)(bi_word_t)x[i] << bits;
+        bits += BI_DIVSTEP_BITS;
+        if (bits >= BI_WORD_BITS) {
+            r[j++] = (bi_word_t)acc;
+            acc >>= BI_WORD_BITS;
+            bits -= BI_WORD_BITS;
+        }
+    }
+
+    for (; j < n; j++) {
+        r[j] = (bi_word_t)acc;
+        acc >>= BI_WORD_BITS;
+    }
+}
+
+// r = x^-1 mod m for odd m, where r has m->words words
+static __bi_result_code_t __bi_mod_inv_odd(bi_word_t *r, MPI x, MPI m) {
+    // Theorem 11.2 of the paper: for f, g below 2^bits, this many divsteps
+    // from delta = 1 always take g to zero
+    uint64_t bits =
+        (uint64_t)BI_WORD_BITS * (x->words > m->words ? x->words : m->words);
+    uint64_t steps = bits < 46 ? (49 * bits + 80) / 17 : (49 * bits + 57) / 17;
+    uint64_t rounds = (steps + BI_DIVSTEP_BITS - 1) / BI_DIVSTEP_BITS;
+    uint32_t len = (uint32_t)(bits / BI_DIVSTEP_BITS) + 1;
+
+    size_t mark = __bi_scratch_mark();
+    bi_sword_t *f = (bi_sword_t *)__bi_scratch_alloc(len);
+    bi_sword_t *g = (bi_sword_t *)__bi_scratch_alloc(len);
+    bi_sword_t *d = (bi_sword_t *)__bi_scratch_alloc(len);
+    bi_sword_t *e = (bi_sword_t *)__bi_scratch_alloc(len);
+    bi_sword_t *ml = (bi_sword_t *)__bi_scratch_alloc(len);
+
+    // f = d x and g = e x mod m throughout
+    __bi_to_divstep(ml, len, m->data, m->words);
+    __bi_to_divstep(g, len, x->data, x->words);
+    for (uint32_t i = 0; i < len; i++) {
+        f[i] = ml[i];
+        d[i] = 0;
+        e[i] = 0;
+    }
+    e[0] = 1;
+
+    bi_word_t m_inv = __bi_word_inv(m->data[0]);
+    int32_t delta = 1;
+    for (uint64_t i = 0; i < rounds; i++) {
+        __bi_divstep_t t;
+        delta = __bi_divsteps(delta, (bi_word_t)f[0], (bi_word_t)g[0], &t);
+        __bi_divstep_fg(f, g, len, &t);
+        __bi_divstep_de(d, e, len, &t, ml, m_inv);
+    }
+
+    // g is zero, so f is +-gcd(x, m), which has to be +-1
+    bi_sword_t neg = f[len - 1] >> (BI_WORD_BITS - 1);
+    bool one = (((bi_word_t)(f[0] ^ neg) & BI_DIVSTEP_MASK) ==
+                (bi_word_t)(neg + 1)) &&
+               (f[len - 1] ^ neg) == 0;
+    for (uint32_t i = 1; i + 1 < len; i++) {
+        one = one && ((bi_word_t)(f[i] ^ neg) & BI_DIVSTEP_MASK) == 0;
+    }
+
+    __bi_divstep_norm(d, neg, ml, len);
+    __bi_from_divstep(r, m->words, d, len);
+    __bi_scratch_release(mark);
+
+    return one ? BI_OK : BI_BAD_OPERANDS;
+}
+
+// q = c / a for c a multiple of the odd a, where q has n words and c has
+// n + k and is clobbered. Each quotient word clears the bottom word of c, as
+// in Montgomery reduction, so the time only depends on the lengths.
+static void __bi_divexact(bi_word_t *q, bi_word_t *c, uint32_t n,
+                          const bi_word_t *a, uint32_t k) {
+    bi_word_t a_inv = __bi_word_inv(a[0]);
+
+    for (uint32_t i = 0; i < n; i++) {
+        q[i] = c[i] * a_inv;
+        bi_word_t borrow = __bi_kernels.submul_1(c + i, a, k, q[i]);
+        __bi_sub_words(c + i + k, c + i + k, n - i, &borrow, 1);
+    }
+}
+
+__bi_result_code_t __bi_mod_inv(MPI r, MPI a, MPI m) {
+    if (bi_eq_val(m, 0)) {
+        return BI_DIV_ZERO;
+    }
+
+    uint32_t n = m->words;
+    __bi_resize(r, n);
+    if (!bi_even(m)) {
+        __bi_result_code_t code = __bi_mod_inv_odd(r->data, a, m);
+        __bi_trim(r);
+        return code;
+    }
+
+    if (bi_even(a)) {
+        return BI_BAD_OPERANDS;
+    }
+
+    if (bi_eq_val(a, 1)) {
+        // 1 is its own inverse, and m > 1 as it's even
+        memset(r->data, 0, (size_t)n * sizeof(bi_word_t));
+        r->data[0] = 1;
+        __bi_trim(r);
+        return BI_OK;
+    }
+
+    // Even moduli swap roles with a, which must be odd. With y = m^-1 mod a,
+    // m y - 1 = k a for some k in [1, m), so a (m - k) = 1 mod m. This is
+    // how the RSA private exponent comes out, as lambda(n) is even.
+    uint32_t k = a->words;
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *y = __bi_scratch_alloc(k);
+    bi_word_t *c = __bi_scratch_alloc(n + k);
+    bi_word_t *q = __bi_scratch_alloc(n);
+
+    __bi_result_code_t code = __bi_mod_inv_odd(y, m, a);
+
+    // c = m y - 1, a row at a time rather than by __bi_mul_words, whose
+    // faster algorithms branch on intermediate values
+    c[n] = __bi_kernels.mul_1(c, m->data, n, y[0]);
+    for (uint32_t i = 1; i < k; i++) {
+        c[n + i] = __bi_kernels.addmul_1(c + i, m->data, n, y[i]);
+    }
+    bi_word_t one = 1;
+    __bi_sub_words(c, c, n + k, &one, 1);
+    __bi_divexact(q, c, n, a->data, k);
+    __bi_sub_words(r->data, m->data, n, q, n);
+
+    __bi_scratch_release(mark);
+    __bi_trim(r);
+
+    return code;
+}
@@ -0,0 +1,415 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+#ifdef BI_HAVE_IFMA
+#include <immintrin.h>
+
+/*
+ * Montgomery multiplication with AVX-512 IFMA, for the RSA sized moduli that
+ * dominate modexp time. Values are held as L limbs of 52 bits in 64 bit
+ * lanes, eight to a vector, and vpmadd52luq / vpmadd52huq add the low and
+ * high halves of each 52 x 52 bit product straight into an accumulator. The
+ * limbs are left to grow past 52 bits while a product is summed, and the
+ * carries between them are only propagated once at the end.
+ *
+ * R = 2^(52L) is at least 4n, so the product of two values below 2n comes
+ * out below 2n without a final subtraction (almost Montgomery
+ * multiplication). Values are only fully reduced on the way out.
+ */
+
+#define BI_IFMA_LIMB_BITS 52
+#define BI_IFMA_MASK (((uint64_t)1 << BI_IFMA_LIMB_BITS) - 1)
+
+// Vectors of eight limbs taken by the largest supported modulus
+#define BI_IFMA_MAX_VECTORS 10
+#define BI_IFMA_MAX_LIMBS (8 * BI_IFMA_MAX_VECTORS)
+
+// Bit buffer for moving between words and limbs
+__extension__ typedef unsigned __int128 __bi_ifma_acc_t;
+
+typedef struct __bi_ifma_ctx {
+    uint32_t vectors; // L / 8
+    uint64_t k0;      // -n^-1 mod 2^52
+    _Alignas(64) uint64_t n[BI_IFMA_MAX_LIMBS];
+    _Alignas(64) uint64_t r2[BI_IFMA_MAX_LIMBS]; // R^2 mod n
+
+    // r = a * b * R^-1, specialised for the size of n
+    void (*amm)(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                const struct __bi_ifma_ctx *ctx);
+} __bi_ifma_ctx_t;
+
+// Modulus sizes with a kernel, and the vectors each one takes. Every size
+// leaves room for R >= 4n with L = ceil((bits + 2) / 52) limbs.
+static const struct {
+    uint32_t bits;
+    uint32_t vectors;
+} __bi_ifma_sizes[] = {{1024, 3}, {2048, 5}, {4096, 10}};
+
+// vectors needed for n, or 0 when it isn't close enough to a supported size
+static uint32_t __bi_ifma_vectors(MPI n) {
+    uint32_t bits = bi_bit_length(n);
+
+    for (uint32_t i = 0; i < sizeof(__bi_ifma_sizes) / sizeof(*__bi_ifma_sizes);
+         i++) {
+        if (bits <= __bi_ifma_sizes[i].bits &&
+            bits > __bi_ifma_sizes[i].bits - 64) {
+            return __bi_ifma_sizes[i].vectors;
+        }
+    }
+
+    return 0;
+}
+
+bool __bi_ifma_usable(MPI n) {
+    return (__bi_kernels.cpu & BI_CPU_AVX512_IFMA) && !bi_even(n) &&
+           __bi_ifma_vectors(n) != 0;
+}
+
+// r = a * b * R^-1 mod n, give or take n, for a, b < 2n. r may alias a or b.
+// Written for a fixed number of vectors, so that once inlined into the
+// per-size wrappers below the loops unroll and the accumulator stays in
+// registers.
+__attribute__((target("avx512f,avx512ifma"), always_inline)) static inline void
+__bi_ifma_amm(uint64_t *r, const uint64_t *a, const uint64_t *b,
+              const __bi_ifma_ctx_t *ctx, uint32_t vectors) {
+    uint32_t limbs = 8 * vectors;
+    __m512i A[BI_IFMA_MAX_VECTORS];
+    __m512i N[BI_IFMA_MAX_VECTORS];
+    __m512i X[BI_IFMA_MAX_VECTORS];
+    const __m512i zero = _mm512_setzero_si512();
+
+    for (uint32_t v = 0; v < vectors; v++) {
+        A[v] = _mm512_loadu_si512(a + 8 * v);
+        N[v] = _mm512_load_si512(ctx->n + 8 * v);
+        X[v] = zero;
+    }
+
+    for (uint32_t i = 0; i < limbs; i++) {
+        __m512i B = _mm512_set1_epi64((long long)b[i]);
+
+        for (uint32_t v = 0; v < vectors; v++) {
+            X[v] = _mm512_madd52lo_epu64(X[v], A[v], B);
+        }
+
+        // chosen so that adding m * n clears the low 52 bits of limb 0
+        uint64_t x0 = (uint64_t)_mm_cvtsi128_si64(_mm512_castsi512_si128(X[0]));
+        uint64_t m = (x0 * ctx->k0) & BI_IFMA_MASK;
+        __m512i M = _mm512_set1_epi64((long long)m);
+
+        for (uint32_t v = 0; v < vectors; v++) {
+            X[v] = _mm512_madd52lo_epu64(X[v], N[v], M);
+        }
+
+        // drop limb 0, keeping the bits above 52 as a carry into limb 1
+        uint64_t carry = (x0 + ((m * ctx->n[0]) & BI_IFMA_MASK)) >>
+                         BI_IFMA_LIMB_BITS;
+        for (uint32_t v = 0; v + 1 < vectors; v++) {
+            X[v] = _mm512_alignr_epi64(X[v + 1], X[v], 1);
+        }
+        X[vectors - 1] = _mm512_alignr_epi64(zero, X[vectors - 1], 1);
+        X[0] = _mm512_add_epi64(
+            X[0], _mm512_zextsi128_si512(_mm_cvtsi64_si128((long long)carry)));
+
+        // the high halves belong a limb up, which is where the shift left
+        // the low halves
+        for (uint32_t v = 0; v < vectors; v++) {
+            X[v] = _mm512_madd52hi_epu64(X[v], A[v], B);
+            X[v] = _mm512_madd52hi_epu64(X[v], N[v], M);
+        }
+    }
+
+    _Alignas(64) uint64_t t[BI_IFMA_MAX_LIMBS];
+    for (uint32_t v = 0; v < vectors; v++) {
+        _mm512_store_si512(t + 8 * v, X[v]);
+    }
+
+    // back to 52 bit limbs. The result is below 2n < R, so nothing carries
+    // out of the top.
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < limbs; i++) {
+        uint64_t s = t[i] + carry;
+        t[i] = s & BI_IFMA_MASK;
+        carry = s >> BI_IFMA_LIMB_BITS;
+    }
+
+    memcpy(r, t, limbs * sizeof(uint64_t));
+}
+
+__attribute__((target("avx512f,avx512ifma"))) static void
+__bi_ifma_amm_1024(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                   const __bi_ifma_ctx_t *ctx) {
+    __bi_ifma_amm(r, a, b, ctx, 3);
+}
+
+__attribute__((target("avx512f,avx512ifma"))) static void
+__bi_ifma_amm_2048(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                   const __bi_ifma_ctx_t *ctx) {
+    __bi_ifma_amm(r, a, b, ctx, 5);
+}
+
+__attribute__((target("avx512f,avx512ifma"))) static void
+__bi_ifma_amm_4096(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                   const __bi_ifma_ctx_t *ctx) {
+    __bi_ifma_amm(r, a, b, ctx, 10);
+}
+
+// x as limbs of 52 bit limbs, where x has words words
+static void __bi_ifma_load(uint64_t *dst, uint32_t limbs, const bi_word_t *x,
+                           uint32_t words) {
+    __bi_ifma_acc_t acc = 0;
+    uint32_t bits = 0;
+    uint32_t w = 0;
+
+    for (uint32_t i = 0; i < limbs; i++) {
+        while (bits < BI_IFMA_LIMB_BITS && w < words) {
+            acc |= (__bi_ifma_acc_t)x[w++] << bits;
+            bits += BI_WORD_BITS;
+        }
+
+        dst[i] = (uint64_t)acc & BI_IFMA_MASK;
+        acc >>= BI_IFMA_LIMB_BITS;
+        bits = bits > BI_IFMA_LIMB_BITS ? bits - BI_IFMA_LIMB_BITS : 0;
+    }
+}
+
+// x back into words words, which have to be enough to hold it
+static void __bi_ifma_store(bi_word_t *dst, uint32_t words, const uint64_t *x,
+                            uint32_t limbs) {
+    __bi_ifma_acc_t acc = 0;
+    uint32_t bits = 0;
+    uint32_t w = 0;
+
+    // limbs past the end of dst are zero
+    for (uint32_t i = 0; i < limbs && w < words; i++) {
+        acc |= (__bi_ifma_acc_t)x[i] << bits;
+        bits += BI_IFMA_LIMB_BITS;
+
+        while (bits >= BI_WORD_BITS && w < words) {
+            dst[w++] = (bi_word_t)acc;
+            acc >>= BI_WORD_BITS;
+            bits -= BI_WORD_BITS;
+        }
+    }
+
+    while (w < words) {
+        dst[w++] = (bi_word_t)acc;
+        acc >>= BI_WORD_BITS;
+    }
+}
+
+static void __bi_ifma_init(__bi_ifma_ctx_t *ctx, MPI n) {
+    ctx->vectors = __bi_ifma_vectors(n);
+    uint32_t limbs = 8 * ctx->vectors;
+
+    switch (ctx->vectors) {
+    case 3:
+        ctx->amm = __bi_ifma_amm_1024;
+        break;
+    case 5:
+        ctx->amm = __bi_ifma_amm_2048;
+        break;
+    default:
+        ctx->amm = __bi_ifma_amm_4096;
+        break;
+    }
+
+    __bi_ifma_load(ctx->n, limbs, n->data, n->words);
+
+    // n^-1 mod 2^64 by Newton iteration, as in __bi_mont_n_inv
+    uint64_t inv = ctx->n[0];
+    for (uint32_t bits = 3; bits < 64; bits *= 2) {
+        inv *= 2u - ctx->n[0] * inv;
+    }
+    ctx->k0 = (0 - inv) & BI_IFMA_MASK;
+
+    // R^2 = 2^(104L), a single bit
+    uint32_t r2_bit = 2 * BI_IFMA_LIMB_BITS * limbs;
+    MPI r2 = bi_init(r2_bit / BI_WORD_BITS + 1);
+    r2->data[r2_bit / BI_WORD_BITS] = (bi_word_t)1 << (r2_bit % BI_WORD_BITS);
+    bi_eucl_div_into(NULL, r2, r2, n);
+    __bi_ifma_load(ctx->r2, limbs, r2->data, r2->words);
+    bi_free(r2);
+}
+
+// The residues handed to the exponentiation are limbs, carried in buffers of
+// words. memcpy in and out keeps the two views of them apart.
+static void __bi_ifma_mul_fn(bi_word_t *r, const bi_word_t *a,
+                             const bi_word_t *b, bi_word_t *t, void *ctx) {
+    __bi_ifma_ctx_t *c = ctx;
+    size_t size = 8 * c->vectors * sizeof(uint64_t);
+    _Alignas(64) uint64_t a_[BI_IFMA_MAX_LIMBS];
+    _Alignas(64) uint64_t b_[BI_IFMA_MAX_LIMBS];
+    (void)t;
+
+    memcpy(a_, a, size);
+    memcpy(b_, b, size);
+    c->amm(a_, a_, b_, c);
+    memcpy(r, a_, size);
+}
+
+static void __bi_ifma_sqr_fn(bi_word_t *r, const bi_word_t *a, bi_word_t *t,
+                             void *ctx) {
+    __bi_ifma_ctx_t *c = ctx;
+    size_t size = 8 * c->vectors * sizeof(uint64_t);
+    _Alignas(64) uint64_t a_[BI_IFMA_MAX_LIMBS];
+    (void)t;
+
+    memcpy(a_, a, size);
+    c->amm(a_, a_, a_, c);
+    memcpy(r, a_, size);
+}
+
+// r = table[idx], where the entries are limbs. Every entry is loaded and
+// masked in, whether or not it's the one asked for.
+__attribute__((target("avx512f"))) static void
+__bi_ifma_select_fn(bi_word_t *r, const bi_word_t *table, uint32_t entries,
+                    bi_word_t idx, void *ctx) {
+    uint32_t vectors = ((__bi_ifma_ctx_t *)ctx)->vectors;
+    uint32_t limbs = 8 * vectors;
+    __m512i R[BI_IFMA_MAX_VECTORS];
+
+    for (uint32_t v = 0; v < vectors; v++) {
+        R[v] = _mm512_setzero_si512();
+    }
+
+    for (uint32_t i = 0; i < entries; i++) {
+        // all ones when i == idx, from the top bit of x | -x as in
+        // __bi_ct_eq
+        uint64_t x = (uint64_t)i ^ (uint64_t)idx;
+        uint64_t mask = ((x | (0 - x)) >> 63) - 1u;
+        __m512i M = _mm512_set1_epi64((long long)mask);
+
+        const bi_word_t *entry = table + (size_t)i * limbs * 64 / BI_WORD_BITS;
+        for (uint32_t v = 0; v < vectors; v++) {
+            __m512i e = _mm512_loadu_si512(entry + 8 * v * 64 / BI_WORD_BITS);
+            R[v] = _mm512_or_si512(R[v], _mm512_and_si512(e, M));
+        }
+    }
+
+    for (uint32_t v = 0; v < vectors; v++) {
+        _mm512_storeu_si512(r + 8 * v * 64 / BI_WORD_BITS, R[v]);
+    }
+}
+
+__bi_modmul_t __bi_ifma_modmul(void *ctx) {
+    __bi_modmul_t mm = {
+        .k = 8 * ((__bi_ifma_ctx_t *)ctx)->vectors * 64 / BI_WORD_BITS,
+        .scratch_words = 0,
+        .mul = __bi_ifma_mul_fn,
+        .sqr = __bi_ifma_sqr_fn,
+        .select = __bi_ifma_select_fn,
+        .ctx = ctx,
+    };
+
+    return mm;
+}
+
+// x = a * R mod n in limbs, from a * R^2 * R^-1, for a < n
+static void __bi_ifma_enter(uint64_t *x, MPI a, const __bi_ifma_ctx_t *ctx) {
+    __bi_ifma_load(x, 8 * ctx->vectors, a->data, a->words);
+    ctx->amm(x, x, ctx->r2, ctx);
+}
+
+// dst = r * R^-1 mod n, fully reduced, into words words. The subtraction of
+// n is masked, so the constant time path stays that way to the end.
+static void __bi_ifma_leave(bi_word_t *dst, uint32_t words, const bi_word_t *r,
+                            const __bi_ifma_ctx_t *ctx) {
+    uint32_t limbs = 8 * ctx->vectors;
+    _Alignas(64) uint64_t x[BI_IFMA_MAX_LIMBS];
+    _Alignas(64) uint64_t y[BI_IFMA_MAX_LIMBS];
+
+    // multiplying by 1 leaves a value of at most n
+    memcpy(x, r, limbs * sizeof(uint64_t));
+    memset(y, 0, limbs * sizeof(uint64_t));
+    y[0] = 1u;
+    ctx->amm(x, x, y, ctx);
+
+    // x - n, kept only if it didn't borrow
+    int64_t borrow = 0;
+    for (uint32_t i = 0; i < limbs; i++) {
+        int64_t d = (int64_t)x[i] - (int64_t)ctx->n[i] + borrow;
+        y[i] = (uint64_t)d & BI_IFMA_MASK;
+        borrow = d >> BI_IFMA_LIMB_BITS;
+    }
+
+    uint64_t keep = (uint64_t)borrow;
+    for (uint32_t i = 0; i < limbs; i++) {
+        x[i] = (y[i] & ~keep) | (x[i] & keep);
+    }
+
+    __bi_ifma_store(dst, words, x, limbs);
+}
+
+MPI __bi_mod_exp_ifma(MPI a, MPI b, MPI n, bool ct) {
+    __bi_ifma_ctx_t ctx;
+    __bi_ifma_init(&ctx, n);
+    uint32_t limbs = 8 * ctx.vectors;
+    __bi_modmul_t mm = __bi_ifma_modmul(&ctx);
+    uint32_t k = mm.k;
+
+    _Alignas(64) uint64_t x[BI_IFMA_MAX_LIMBS];
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *base = __bi_scratch_alloc(k);
+    bi_word_t *r = __bi_scratch_alloc(k);
+
+    if (bi_lt(a, n)) {
+        __bi_ifma_enter(x, a, &ctx);
+    } else {
+        MPI a_mod = bi_init(n->words);
+        bi_eucl_div_into(NULL, a_mod, a, n);
+        __bi_ifma_enter(x, a_mod, &ctx);
+        bi_free(a_mod);
+    }
+    memcpy(base, x, limbs * sizeof(uint64_t));
+
+    if (ct) {
+        // R mod n stands in for 1
+        bi_word_t *one = __bi_scratch_alloc(k);
+        memset(x, 0, limbs * sizeof(uint64_t));
+        x[0] = 1u;
+        ctx.amm(x, x, ctx.r2, &ctx);
+        memcpy(one, x, limbs * sizeof(uint64_t));
+
+        __bi_window_exp_ct(r, one, base, b, &mm);
+    } else {
+        __bi_window_exp(r, base, b, &mm);
+    }
+
+    MPI res = bi_init(n->words);
+    __bi_ifma_leave(res->data, n->words, r, &ctx);
+    __bi_scratch_release(mark);
+    __bi_trim(res);
+
+    return res;
+}
+
+void *__bi_ifma_new(MPI n) {
+    // the limb arrays are 64 byte aligned, and so is the struct's size
+    __bi_ifma_ctx_t *ctx = aligned_alloc(64, sizeof(__bi_ifma_ctx_t));
+    if (ctx) {
+        __bi_ifma_init(ctx, n);
+    }
+
+    return ctx;
+}
+
+void __bi_ifma_to_mont(bi_word_t *dst, MPI x, void *ctx) {
+    __bi_ifma_ctx_t *c = ctx;
+    _Alignas(64) uint64_t x_[BI_IFMA_MAX_LIMBS];
+
+    __bi_ifma_enter(x_, x, c);
+    memcpy(dst, x_, 8 * c->vectors * sizeof(uint64_t));
+}
+
+void __bi_ifma_from_mont(bi_word_t *dst, uint32_t words, const bi_word_t *x,
+                         void *ctx) {
+    __bi_ifma_leave(dst, words, x, ctx);
+}
+
+#endif
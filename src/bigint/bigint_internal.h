@@ -0,0 +1,429 @@
+#ifndef __bigint_internal
+#define __bigint_internal
+
+#include <bigint/bigint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Definitions shared between the bigint translation units, but not part of
+ * the public API.
+ */
+
+#define BI_WORD_MAX ((bi_word_t)~(bi_word_t)0)
+#define BI_WORD_TOP_BIT ((bi_word_t)1 << (BI_WORD_BITS - 1))
+
+// Signed double word, for borrows that need an arithmetic right shift, and
+// the signed word to go with it
+#ifdef BIGINT_64BIT_LIMBS
+typedef int64_t bi_sword_t;
+__extension__ typedef __int128 bi_sdword_t;
+#define BI_WORD_FMT "%016" PRIx64
+#else
+typedef int32_t bi_sword_t;
+typedef int64_t bi_sdword_t;
+#define BI_WORD_FMT "%08" PRIx32
+#endif
+
+// Leading/trailing zero bits of a non-zero word
+static inline uint32_t __bi_clz(bi_word_t x) {
+#ifdef BIGINT_64BIT_LIMBS
+    return __builtin_clzll(x);
+#else
+    return __builtin_clz(x);
+#endif
+}
+
+static inline uint32_t __bi_ctz(bi_word_t x) {
+#ifdef BIGINT_64BIT_LIMBS
+    return __builtin_ctzll(x);
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+typedef enum {
+    BI_OK,
+    BI_MEM_ERR,
+    BI_DIV_ZERO,
+    BI_BAD_OPERANDS,
+} __bi_result_code_t;
+
+typedef struct {
+    MPI x;
+    __bi_result_code_t code;
+} __bi_result_t;
+
+static inline __bi_result_t bi_result_make(MPI x, __bi_result_code_t code) {
+    __bi_result_t res = {x, code};
+    return res;
+}
+
+static inline __bi_result_t bi_result_error(__bi_result_code_t code) {
+    return bi_result_make(NULL, code);
+}
+
+/*
+ * Operands of at least this many words are multiplied with Karatsuba rather
+ * than the schoolbook method. Override with -DBI_KARATSUBA_THRESHOLD=...
+ * to tune for a particular machine. Must be at least 4.
+ */
+#ifndef BI_KARATSUBA_THRESHOLD
+#define BI_KARATSUBA_THRESHOLD 24
+#endif
+
+/*
+ * Squares of at least this many words use Karatsuba. The schoolbook square
+ * only does half the word products, so this sits above the multiply
+ * threshold. Must be at least 4.
+ */
+#ifndef BI_KARATSUBA_SQR_THRESHOLD
+#define BI_KARATSUBA_SQR_THRESHOLD 32
+#endif
+
+/*
+ * Balanced operands of at least this many words use Toom-3 instead of
+ * Karatsuba. Must be at least 5.
+ */
+#ifndef BI_TOOM3_THRESHOLD
+#define BI_TOOM3_THRESHOLD 150
+#endif
+
+/*
+ * Operands where the shorter one has at least this many words are
+ * multiplied with number theoretic transforms (see bigint_ntt.c), as long as
+ * the product is within BI_NTT_MAX_WORDS.
+ */
+#ifndef BI_NTT_THRESHOLD
+#define BI_NTT_THRESHOLD 8192
+#endif
+
+// The NTT primes support transforms of up to 2^26 16 bit digits
+#define BI_NTT_MAX_WORDS ((1u << 26) / (BI_WORD_BITS / 16))
+
+/*
+ * Divisors and quotients of at least this many words are divided by
+ * Burnikel-Ziegler recursion (see bigint_div.c) rather than Knuth D alone,
+ * which pays off once the multiplications it's built on are below
+ * schoolbook. Must be at least 2.
+ */
+#ifndef BI_BZ_THRESHOLD
+#define BI_BZ_THRESHOLD 60
+#endif
+
+/*
+ * Thread local scratch space (see bigint_scratch.c). Take a mark, allocate
+ * any number of word buffers, then release back to the mark before
+ * returning. Releases must nest like a stack.
+ */
+size_t __bi_scratch_mark(void);
+bi_word_t *__bi_scratch_alloc(size_t words);
+void __bi_scratch_release(size_t mark);
+
+/*
+ * Word level primitives (see bigint_words.c). These work directly on
+ * little-endian word arrays and never allocate, and the rest of the library
+ * is built on them, along with the row kernels further down.
+ */
+
+// r = a + b, where a has n words and b has m <= n words. r may alias a or b.
+// Returns the carry.
+bi_word_t __bi_add_words(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                         const bi_word_t *b, uint32_t m);
+
+// r = a - b, where a has n words and b has m <= n words. r may alias a or b.
+// Returns the borrow, so the result is also correct as an n word two's
+// complement value.
+bi_word_t __bi_sub_words(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                         const bi_word_t *b, uint32_t m);
+
+// r += b and r -= b, where r has n words and b has m <= n words. Above b
+// these stop as soon as the carry or borrow runs out, which makes them the
+// cheap way to ripple one up a long value, but not constant time. Return the
+// carry or borrow out of the top.
+bi_word_t __bi_add_words_in_place(bi_word_t *r, uint32_t n, const bi_word_t *b,
+                                  uint32_t m);
+bi_word_t __bi_sub_words_in_place(bi_word_t *r, uint32_t n, const bi_word_t *b,
+                                  uint32_t m);
+
+// r = a << s for s < BI_WORD_BITS, where r and a have n words and r may
+// alias a or any words above it. Returns the bits shifted out of the top.
+bi_word_t __bi_shl_bits(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        uint32_t s);
+
+// r = a >> s for s < BI_WORD_BITS, where r and a have n words and r may
+// alias a or any words below it. Returns the bits shifted out of the bottom,
+// in the top of the word.
+bi_word_t __bi_shr_bits(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        uint32_t s);
+
+// -1, 0 or 1 as the n word a is below, equal to or above the n word b
+int __bi_cmp_words(const bi_word_t *a, const bi_word_t *b, uint32_t n);
+
+// r = a * b, where r has n + m words and doesn't overlap a or b. Picks the
+// algorithm based on operand size, and squares when a and b are the same
+// operand.
+void __bi_mul_words(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                    const bi_word_t *b, uint32_t m);
+
+// r = a^2, where r has 2n words and doesn't overlap a
+void __bi_sqr_words(bi_word_t *r, const bi_word_t *a, uint32_t n);
+
+// r = a * b by NTT, where r has n + m <= BI_NTT_MAX_WORDS words
+void __bi_mul_ntt(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                  const bi_word_t *b, uint32_t m);
+
+// Whether x is using the buffer inside its struct rather than the heap
+static inline bool __bi_is_inline(MPI x) { return x->data == x->inline_data; }
+
+// Frees the limbs of x if they're on the heap. x->data is left dangling.
+static inline void __bi_free_data(MPI x) {
+    if (!__bi_is_inline(x)) {
+        free(x->data);
+    }
+}
+
+// Makes room for at least words words, keeping the current value
+__bi_result_code_t __bi_reserve(MPI x, uint32_t words);
+
+// Sets x to exactly words words, reallocating only when it outgrows its
+// capacity. The low words are kept and any new words are zeroed. Exits if out
+// of memory.
+void __bi_resize(MPI x, uint32_t words);
+
+// Drops leading zero words. The storage is kept.
+static inline void __bi_trim(MPI x) {
+    while (x->words > 1 && x->data[x->words - 1] == 0) {
+        x->words--;
+    }
+}
+
+// Knuth's algorithm D, or Burnikel-Ziegler for large operands. q and r may be
+// NULL if they aren't needed.
+__bi_result_code_t __bi_eucl_div(MPI u, MPI v, MPI *q, MPI *r);
+
+// q = u / v and r = u % v, where u has m >= n words, v has n words with a
+// non-zero top word, q has m - n + 1 words and r has n words. Either output
+// may be NULL, and either may alias u or v.
+void __bi_div_words(bi_word_t *q, bi_word_t *r, const bi_word_t *u,
+                    uint32_t m, const bi_word_t *v, uint32_t n);
+
+// The reciprocal floor((B^3 - 1) / d) - B of the two word divisor d1 d0,
+// where d1 has its top bit set, which turns each quotient word of a long
+// division into multiplications instead of a hardware divide
+bi_word_t __bi_div_reciprocal(bi_word_t d1, bi_word_t d0);
+
+// q = U / V, for V of n >= 2 words with its top bit set and U of m + 1 words
+// whose top n words are below V. d_inv is the reciprocal of V's top two
+// words. q gets m - n + 1 words and may be NULL. The remainder is left in the
+// low n words of U and U[n] is zeroed, while the rest of U is clobbered.
+// Large operands go by Burnikel-Ziegler recursion, the rest by Knuth D.
+void __bi_div_norm(bi_word_t *q, bi_word_t *U, uint32_t m, const bi_word_t *V,
+                   uint32_t n, bi_word_t d_inv);
+
+// r = U >> s for s < BI_WORD_BITS, where r has n words and U has n + 1, the
+// last step of dividing with a divisor shifted left by s bits
+static inline void __bi_div_unnorm(bi_word_t *r, const bi_word_t *U,
+                                   uint32_t n, uint32_t s) {
+    for (uint32_t i = 0; i < n; i++) {
+        r[i] = s ? (U[i] >> s) | (U[i + 1] << (BI_WORD_BITS - s)) : U[i];
+    }
+}
+
+// g = gcd(a, b) by Lehmer's algorithm (see bigint_gcd.c). Unless s is NULL,
+// s and s_neg are also set to the magnitude and sign of a Bezout
+// coefficient of a, so that s * a = g mod b.
+void __bi_gcdext(MPI g, MPI s, bool *s_neg, MPI a, MPI b);
+
+// r = a^-1 mod m by safegcd divsteps (see bigint_gcd.c), in time that only
+// depends on the word lengths of a and m and on whether each is odd. Gives
+// BI_BAD_OPERANDS when they aren't coprime.
+__bi_result_code_t __bi_mod_inv(MPI r, MPI a, MPI m);
+
+/*
+ * A modular multiplier on k word residues, so that exponentiation can run on
+ * any of the reduction backends. t is scratch space of scratch_words words,
+ * and r may alias a or b. select is an optional constant time r = table[idx]
+ * for backends that can scan the table faster than word by word.
+ */
+typedef struct {
+    uint32_t k;
+    size_t scratch_words;
+    void (*mul)(bi_word_t *r, const bi_word_t *a, const bi_word_t *b,
+                bi_word_t *t, void *ctx);
+    void (*sqr)(bi_word_t *r, const bi_word_t *a, bi_word_t *t, void *ctx);
+    void (*select)(bi_word_t *r, const bi_word_t *table, uint32_t entries,
+                   bi_word_t idx, void *ctx);
+    void *ctx;
+} __bi_modmul_t;
+
+// r = base^e for e > 0 by sliding window, with the products of mm. r and base
+// have mm->k words.
+void __bi_window_exp(bi_word_t *r, const bi_word_t *base, MPI e,
+                     const __bi_modmul_t *mm);
+
+// r = the product of bases[i]^exps[i] for i < count, where bases holds count
+// residues of mm->k words one after the other and one is the multiplicative
+// identity. Each exponent gets its own sliding window and table as in
+// __bi_window_exp, but the squarings are shared (Straus' method), so all of
+// them together cost one squaring per bit of the longest.
+void __bi_multi_exp(bi_word_t *r, const bi_word_t *one,
+                    const bi_word_t *bases, MPI *exps, uint32_t count,
+                    const __bi_modmul_t *mm);
+
+// r = base^e by fixed windows, where one is the multiplicative identity in
+// the representation mm works in. Every bit of e's words is processed and
+// the table is read in full for each window, so as long as mm's kernels are
+// constant time, so is this.
+void __bi_window_exp_ct(bi_word_t *r, const bi_word_t *one,
+                        const bi_word_t *base, MPI e, const __bi_modmul_t *mm);
+
+/*
+ * Lim-Lee comb exponentiation for a fixed base (bigint_exp.c). Exponent bits
+ * i * spacing + j, for the teeth values of i, make up the index of one table
+ * entry, so an exponent of up to teeth * spacing bits takes spacing
+ * multiplications. Each column is split over BI_COMB_TABLES tables, the later
+ * ones raised to the power 2^(s * ceil(spacing / BI_COMB_TABLES)), which cuts
+ * the squarings to spacing / BI_COMB_TABLES.
+ */
+#define BI_COMB_TABLES 2u
+
+// fills table, which has BI_COMB_TABLES << teeth entries of mm->k words, from
+// base and one in mm's representation
+void __bi_comb_build(bi_word_t *table, const bi_word_t *one,
+                     const bi_word_t *base, uint32_t teeth, uint32_t spacing,
+                     const __bi_modmul_t *mm);
+
+// r = base^e, for e of at most teeth * spacing bits, from the tables built by
+// __bi_comb_build
+void __bi_comb_exp(bi_word_t *r, const bi_word_t *one, const bi_word_t *table,
+                   uint32_t teeth, uint32_t spacing, MPI e,
+                   const __bi_modmul_t *mm);
+
+// a^b % n for odd n, using Montgomery reduction
+MPI __bi_mod_exp_mont(MPI a, MPI b, MPI n);
+
+// a^b % n for any n > 1, using Barrett reduction
+MPI __bi_mod_exp_barrett(MPI a, MPI b, MPI n);
+
+/*
+ * Montgomery multiplication for work that sets up its own context rather than
+ * going through __bi_mod_exp_mont, such as bi_fixed_base_t's tables or a
+ * batch of exponentiations. The RSA sized moduli go through the IFMA
+ * kernels, as they would in bi_mod_exp, when they cover n: __bi_mont_ifma
+ * gives their context for ctx's modulus, or NULL, and it goes back with
+ * free(). The multiplier only reads its contexts, so threads can share them.
+ */
+void *__bi_mont_ifma(bi_mont_ctx_t *ctx);
+__bi_modmul_t __bi_mont_modmul(bi_mont_ctx_t *ctx, void *ifma);
+
+// dst = x * R mod n in __bi_mont_modmul's representation, for x < n
+void __bi_mont_enter(bi_word_t *dst, MPI x, bi_mont_ctx_t *ctx, void *ifma);
+
+// dst = r * R^-1 mod n, out of __bi_mont_modmul's representation. r has
+// 2 * mm.k + 1 words and is clobbered, and dst may be any bigint.
+void __bi_mont_leave(MPI dst, bi_word_t *r, bi_mont_ctx_t *ctx, void *ifma);
+
+// Barrett multiplication mod ctx's modulus, on residues of k words
+__bi_modmul_t __bi_barrett_modmul(bi_barrett_ctx_t *ctx);
+
+// the product of a[i]^b[i] % n for i < count, for odd n. Uses the IFMA
+// kernels when they cover n, and Montgomery reduction otherwise.
+MPI __bi_mod_multi_exp_mont(MPI *a, MPI *b, uint32_t count, MPI n);
+
+// the same for any n > 1, using Barrett reduction
+MPI __bi_mod_multi_exp_barrett(MPI *a, MPI *b, uint32_t count, MPI n);
+
+/*
+ * CPU features the kernels can make use of, probed once when the library is
+ * loaded. The BIGINT_CPU environment variable caps them at a tier (generic,
+ * adx, avx2 or ifma) so the slower kernels can be benchmarked on a fast
+ * machine.
+ */
+#define BI_CPU_BMI2 (1u << 0)
+#define BI_CPU_ADX (1u << 1)
+#define BI_CPU_AVX2 (1u << 2)
+#define BI_CPU_AVX512_IFMA (1u << 3)
+
+/*
+ * Row kernels picked for this CPU, which the schoolbook products, Montgomery
+ * reduction and Knuth D are built on. Each runs over n >= 0 words of a
+ * multiplied by the word b:
+ *   mul_1:    r = a * b, returning the carry word
+ *   addmul_1: r += a * b, returning the carry word
+ *   submul_1: r -= a * b, returning the borrow word
+ * bi_mod_exp_ct depends on every version running in time that only depends
+ * on n. Until the library's constructor has run these are the generic C
+ * versions.
+ */
+typedef bi_word_t (*__bi_row_fn)(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                                 bi_word_t b);
+
+typedef struct {
+    uint32_t cpu; // BI_CPU_* flags in use
+    __bi_row_fn mul_1;
+    __bi_row_fn addmul_1;
+    __bi_row_fn submul_1;
+} __bi_kernels_t;
+
+extern __bi_kernels_t __bi_kernels;
+
+// Generic C kernels in bigint_words.c, which every tier falls back to
+bi_word_t __bi_mul_1(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                     bi_word_t b);
+bi_word_t __bi_addmul_1(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        bi_word_t b);
+bi_word_t __bi_submul_1(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        bi_word_t b);
+
+// r = a^2 by the schoolbook method, where r has 2n words and doesn't overlap
+// a. The running time depends only on n.
+void __bi_sqr_schoolbook(bi_word_t *r, const bi_word_t *a, uint32_t n);
+
+#if defined(__x86_64__) && defined(__GNUC__) && defined(BIGINT_64BIT_LIMBS)
+// MULX/ADCX/ADOX versions, in bigint_adx.c, for CPUs with BMI2 and ADX
+#define BI_HAVE_ADX
+bi_word_t __bi_mul_1_adx(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                         bi_word_t b);
+bi_word_t __bi_addmul_1_adx(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                            bi_word_t b);
+bi_word_t __bi_submul_1_adx(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                            bi_word_t b);
+#endif
+
+/*
+ * AVX-512 IFMA Montgomery multiplication for 1024, 2048 and 4096 bit moduli,
+ * in bigint_ifma.c. Only built for x86-64 with GCC compatible compilers, and
+ * only used when the CPU has the instructions.
+ */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BI_HAVE_IFMA
+
+// whether n is odd, one of the supported sizes, and IFMA is enabled
+bool __bi_ifma_usable(MPI n);
+
+// a^b % n with the IFMA kernels, for n that passes __bi_ifma_usable. ct
+// picks the constant time fixed window exponentiation.
+MPI __bi_mod_exp_ifma(MPI a, MPI b, MPI n, bool ct);
+
+// A heap allocated IFMA context for n, kept across calls for
+// bi_fixed_base_t's tables. Goes back with free(), and is NULL when it can't
+// be allocated.
+void *__bi_ifma_new(MPI n);
+
+// the multiplier on a context from __bi_ifma_new. Residues are in the
+// kernels' limb form, mm->k words each.
+__bi_modmul_t __bi_ifma_modmul(void *ctx);
+
+// dst = x * R mod n, for x < n
+void __bi_ifma_to_mont(bi_word_t *dst, MPI x, void *ctx);
+
+// dst = x * R^-1 mod n, fully reduced, into words words
+void __bi_ifma_from_mont(bi_word_t *dst, uint32_t words, const bi_word_t *x,
+                         void *ctx);
+#endif
+
+#endif
@@ -0,0 +1,177 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+/*
+ * Destination-passing versions of the basic operations. The result goes into
+ * an existing bigint, whose storage is reused and only grown when the result
+ * doesn't fit, so loops that keep their temporaries around don't allocate on
+ * every iteration. The destination may be any of the inputs.
+ */
+
+void bi_add_into(MPI dst, MPI a, MPI b) {
+    MPI hi = a->words >= b->words ? a : b;
+    MPI lo = hi == a ? b : a;
+    uint32_t n = hi->words;
+    uint32_t m = lo->words;
+
+    // growing dst may move the data of whichever input it aliases
+    __bi_resize(dst, n + 1);
+    dst->data[n] = __bi_add_words(dst->data, hi->data, n, lo->data, m);
+    __bi_trim(dst);
+}
+
+void bi_sub_into(MPI dst, MPI a, MPI b) {
+    // matches bi_sub, which clamps to 0 rather than wrapping
+    if (!bi_ge(a, b)) {
+        __bi_resize(dst, 1);
+        dst->data[0] = 0;
+        return;
+    }
+
+    // a >= b, so any words of b past the top of a are zero
+    uint32_t n = a->words;
+    uint32_t m = b->words < n ? b->words : n;
+
+    __bi_resize(dst, n);
+    __bi_sub_words(dst->data, a->data, n, b->data, m);
+    __bi_trim(dst);
+}
+
+void bi_mul_into(MPI dst, MPI a, MPI b) {
+    uint32_t n = a->words;
+    uint32_t m = b->words;
+
+    if (dst != a && dst != b) {
+        __bi_resize(dst, n + m);
+        __bi_mul_words(dst->data, a->data, n, b->data, m);
+        __bi_trim(dst);
+        return;
+    }
+
+    // the multiply kernels can't write over their inputs
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *r = __bi_scratch_alloc(n + m);
+    __bi_mul_words(r, a->data, n, b->data, m);
+
+    __bi_resize(dst, n + m);
+    memcpy(dst->data, r, (size_t)(n + m) * sizeof(bi_word_t));
+    __bi_scratch_release(mark);
+    __bi_trim(dst);
+}
+
+void bi_sqr_into(MPI dst, MPI a) {
+    uint32_t n = a->words;
+
+    if (dst != a) {
+        __bi_resize(dst, 2 * n);
+        __bi_sqr_words(dst->data, a->data, n);
+        __bi_trim(dst);
+        return;
+    }
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *r = __bi_scratch_alloc(2 * (size_t)n);
+    __bi_sqr_words(r, a->data, n);
+
+    __bi_resize(dst, 2 * n);
+    memcpy(dst->data, r, 2 * (size_t)n * sizeof(bi_word_t));
+    __bi_scratch_release(mark);
+    __bi_trim(dst);
+}
+
+void bi_shift_left_into(MPI dst, MPI a, uint32_t n) {
+    uint32_t na = a->words;
+    uint32_t offset_words = n / BI_WORD_BITS;
+
+    __bi_resize(dst, na + offset_words + 1);
+    bi_word_t *r = dst->data;
+
+    // the shift runs top down, so it's safe when dst is a
+    r[na + offset_words] =
+        __bi_shl_bits(r + offset_words, a->data, na, n % BI_WORD_BITS);
+    memset(r, 0, (size_t)offset_words * sizeof(bi_word_t));
+    __bi_trim(dst);
+}
+
+void bi_shift_right_into(MPI dst, MPI a, uint32_t n) {
+    uint32_t na = a->words;
+    uint32_t offset_words = n / BI_WORD_BITS;
+
+    if (offset_words >= na) {
+        __bi_resize(dst, 1);
+        dst->data[0] = 0;
+        return;
+    }
+
+    uint32_t words = na - offset_words;
+
+    // when shifting in place, only shrink once the source has been read
+    if (dst != a) {
+        __bi_resize(dst, words);
+    }
+
+    __bi_shr_bits(dst->data, a->data + offset_words, words, n % BI_WORD_BITS);
+
+    if (dst == a) {
+        __bi_resize(dst, words);
+    }
+
+    __bi_trim(dst);
+}
+
+void bi_eucl_div_into(MPI q, MPI r, MPI u, MPI v) {
+    // significant lengths, without squeezing the inputs
+    uint32_t m = u->words;
+    uint32_t n = v->words;
+    while (m > 1 && u->data[m - 1] == 0) {
+        m--;
+    }
+    while (n > 1 && v->data[n - 1] == 0) {
+        n--;
+    }
+
+    if (n == 1 && v->data[0] == 0) {
+        printf("ERROR in bi_eucl_div_into, code: %d", BI_DIV_ZERO);
+        exit(1);
+    }
+
+    if (m < n) {
+        // u < v. r takes u before q can overwrite it.
+        if (r && r != u) {
+            __bi_resize(r, m);
+            memcpy(r->data, u->data, (size_t)m * sizeof(bi_word_t));
+        }
+        if (q) {
+            __bi_resize(q, 1);
+            q->data[0] = 0;
+        }
+        if (r) {
+            __bi_trim(r);
+        }
+        return;
+    }
+
+    // resizing keeps the low words, so this is safe when q or r is u or v
+    if (q) {
+        __bi_resize(q, m - n + 1);
+    }
+    if (r) {
+        __bi_resize(r, n);
+    }
+
+    __bi_div_words(q ? q->data : NULL, r ? r->data : NULL, u->data, m,
+                   v->data, n);
+
+    if (q) {
+        __bi_trim(q);
+    }
+    if (r) {
+        __bi_trim(r);
+    }
+}
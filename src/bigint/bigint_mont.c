@@ -0,0 +1,566 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+// -n^-1 mod 2^w, by Newton iteration. Each step doubles the number of
+// correct low bits, and n * n = 1 mod 8 gives us the first 3 for free.
+static bi_word_t __bi_mont_n_inv(bi_word_t n0) {
+    bi_word_t inv = n0;
+    for (uint32_t bits = 3; bits < BI_WORD_BITS; bits *= 2) {
+        inv *= 2u - n0 * inv;
+    }
+
+    return (bi_word_t)0 - inv;
+}
+
+__bi_result_code_t __bi_mont_init(bi_mont_ctx_t *ctx, MPI n) {
+    if (bi_even(n)) {
+        return BI_BAD_OPERANDS;
+    }
+
+    ctx->n = bi_init_and_copy(n);
+    bi_squeeze(ctx->n);
+    ctx->n_inv = __bi_mont_n_inv(ctx->n->data[0]);
+
+    // R^2 = 2^(2 * BI_WORD_BITS * k), which is a single bit in word 2k
+    uint32_t k = ctx->n->words;
+    MPI r2 = bi_init(2 * k + 1);
+    r2->data[2 * k] = 1u;
+    bi_eucl_div(r2, ctx->n, NULL, &ctx->r2);
+    bi_free(r2);
+
+    return BI_OK;
+}
+
+void bi_mont_init(bi_mont_ctx_t *ctx, MPI n) {
+    __bi_result_code_t code = __bi_mont_init(ctx, n);
+    if (code != BI_OK) {
+        printf("ERROR in bi_mont_init, modulus must be odd. code: %d", code);
+        exit(1);
+    }
+}
+
+void bi_mont_free(bi_mont_ctx_t *ctx) {
+    bi_free(ctx->n);
+    bi_free(ctx->r2);
+}
+
+// r = t * R^-1 mod n, where t has 2k + 1 words, t < n * R, and r has k
+// words. t is clobbered.
+static void __bi_mont_redc(bi_word_t *r, bi_word_t *t, bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    bi_word_t *n = ctx->n->data;
+
+    for (uint32_t i = 0; i < k; i++) {
+        // chosen so that t[i] becomes zero
+        bi_word_t m = t[i] * ctx->n_inv;
+        bi_word_t carry = __bi_kernels.addmul_1(t + i, n, k, m);
+        __bi_add_words_in_place(t + i + k, k + 1 - i, &carry, 1);
+    }
+
+    // t / R is now in t[k..2k], and is < 2n
+    bi_word_t *u = t + k;
+    if (u[k] != 0 || __bi_cmp_words(u, n, k) >= 0) {
+        __bi_sub_words(r, u, k, n, k);
+    } else {
+        memcpy(r, u, k * sizeof(bi_word_t));
+    }
+}
+
+// r = a * b * R^-1 mod n, where a, b and r have k words and t is scratch
+// space of 2k + 1 words. r may alias a or b.
+static void __bi_mont_mul_words(bi_word_t *r, const bi_word_t *a,
+                                const bi_word_t *b, bi_word_t *t,
+                                bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+
+    __bi_mul_words(t, a, k, b, k);
+    t[2 * k] = 0u;
+    __bi_mont_redc(r, t, ctx);
+}
+
+// r = a * a * R^-1 mod n, with the same buffer rules as __bi_mont_mul_words
+static void __bi_mont_sqr_words(bi_word_t *r, const bi_word_t *a, bi_word_t *t,
+                                bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+
+    __bi_sqr_words(t, a, k);
+    t[2 * k] = 0u;
+    __bi_mont_redc(r, t, ctx);
+}
+
+// copies x into a zero padded k word buffer. Assumes x < n.
+static void __bi_mont_load(bi_word_t *dst, MPI x, uint32_t k) {
+    memset(dst, 0, k * sizeof(bi_word_t));
+    memcpy(dst, x->data, (x->words < k ? x->words : k) * sizeof(bi_word_t));
+}
+
+void bi_mont_mul_into(MPI dst, MPI a, MPI b, bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *a_ = __bi_scratch_alloc(k);
+    bi_word_t *b_ = __bi_scratch_alloc(k);
+    bi_word_t *t = __bi_scratch_alloc(2 * (size_t)k + 1);
+
+    __bi_mont_load(a_, a, k);
+    __bi_mont_load(b_, b, k);
+
+    // the operands have been copied out, so dst can be one of them
+    __bi_resize(dst, k);
+    __bi_mont_mul_words(dst->data, a_, b_, t, ctx);
+    __bi_scratch_release(mark);
+
+    __bi_trim(dst);
+}
+
+MPI bi_mont_mul(MPI a, MPI b, bi_mont_ctx_t *ctx) {
+    MPI res = bi_init(ctx->n->words);
+    bi_mont_mul_into(res, a, b, ctx);
+
+    return res;
+}
+
+void bi_mont_sqr_into(MPI dst, MPI a, bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *a_ = __bi_scratch_alloc(k);
+    bi_word_t *t = __bi_scratch_alloc(2 * (size_t)k + 1);
+
+    __bi_mont_load(a_, a, k);
+
+    __bi_resize(dst, k);
+    __bi_mont_sqr_words(dst->data, a_, t, ctx);
+    __bi_scratch_release(mark);
+
+    __bi_trim(dst);
+}
+
+MPI bi_mont_sqr(MPI a, bi_mont_ctx_t *ctx) {
+    MPI res = bi_init(ctx->n->words);
+    bi_mont_sqr_into(res, a, ctx);
+
+    return res;
+}
+
+void bi_mont_exp_into(MPI dst, MPI a, MPI e, bi_mont_ctx_t *ctx) {
+    if (bi_eq_val(e, 0u)) {
+        // R mod n, the Montgomery form of 1
+        MPI one = bi_init(1);
+        bi_set(one, 1u);
+        MPI one_mont = bi_to_mont(one, ctx);
+        bi_copy(one_mont, dst);
+        bi_free(one);
+        bi_free(one_mont);
+        return;
+    }
+
+    __bi_modmul_t mm = __bi_mont_modmul(ctx, NULL);
+    uint32_t k = mm.k;
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *base = __bi_scratch_alloc(k);
+    bi_word_t *r = __bi_scratch_alloc(k);
+    __bi_mont_load(base, a, k);
+    __bi_window_exp(r, base, e, &mm);
+
+    // a and e have been read in full, so dst can be either
+    __bi_resize(dst, k);
+    memcpy(dst->data, r, k * sizeof(bi_word_t));
+    __bi_scratch_release(mark);
+
+    __bi_trim(dst);
+}
+
+MPI bi_mont_exp(MPI a, MPI e, bi_mont_ctx_t *ctx) {
+    MPI res = bi_init(ctx->n->words);
+    bi_mont_exp_into(res, a, e, ctx);
+
+    return res;
+}
+
+MPI bi_to_mont(MPI x, bi_mont_ctx_t *ctx) {
+    if (bi_lt(x, ctx->n)) {
+        return bi_mont_mul(x, ctx->r2, ctx);
+    }
+
+    MPI x_mod;
+    bi_eucl_div(x, ctx->n, NULL, &x_mod);
+    MPI res = bi_mont_mul(x_mod, ctx->r2, ctx);
+    bi_free(x_mod);
+
+    return res;
+}
+
+MPI bi_from_mont(MPI x, bi_mont_ctx_t *ctx) {
+    MPI one = bi_init(1);
+    bi_set(one, 1u);
+    MPI res = bi_mont_mul(x, one, ctx);
+    bi_free(one);
+
+    return res;
+}
+
+static void __bi_mont_mul_fn(bi_word_t *r, const bi_word_t *a,
+                             const bi_word_t *b, bi_word_t *t, void *ctx) {
+    __bi_mont_mul_words(r, a, b, t, ctx);
+}
+
+static void __bi_mont_sqr_fn(bi_word_t *r, const bi_word_t *a, bi_word_t *t,
+                             void *ctx) {
+    __bi_mont_sqr_words(r, a, t, ctx);
+}
+
+MPI __bi_mod_exp_mont(MPI a, MPI b, MPI n) {
+    bi_mont_ctx_t ctx;
+    bi_mont_init(&ctx, n);
+    uint32_t k = ctx.n->words;
+
+    __bi_modmul_t mm = {
+        .k = k,
+        .scratch_words = 2 * (size_t)k + 1,
+        .mul = __bi_mont_mul_fn,
+        .sqr = __bi_mont_sqr_fn,
+        .ctx = &ctx,
+    };
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *base = __bi_scratch_alloc(k);
+    MPI base_mont = bi_to_mont(a, &ctx);
+    __bi_mont_load(base, base_mont, k);
+    bi_free(base_mont);
+
+    MPI res = bi_init(k);
+    __bi_window_exp(res->data, base, b, &mm);
+    __bi_scratch_release(mark);
+
+    MPI out = bi_from_mont(res, &ctx);
+
+    bi_free(res);
+    bi_mont_free(&ctx);
+
+    return out;
+}
+
+void *__bi_mont_ifma(bi_mont_ctx_t *ctx) {
+#ifdef BI_HAVE_IFMA
+    if (__bi_ifma_usable(ctx->n)) {
+        return __bi_ifma_new(ctx->n);
+    }
+#endif
+    (void)ctx;
+
+    return NULL;
+}
+
+__bi_modmul_t __bi_mont_modmul(bi_mont_ctx_t *ctx, void *ifma) {
+#ifdef BI_HAVE_IFMA
+    if (ifma) {
+        return __bi_ifma_modmul(ifma);
+    }
+#endif
+    (void)ifma;
+
+    uint32_t k = ctx->n->words;
+    __bi_modmul_t mm = {
+        .k = k,
+        .scratch_words = 2 * (size_t)k + 1,
+        .mul = __bi_mont_mul_fn,
+        .sqr = __bi_mont_sqr_fn,
+        .ctx = ctx,
+    };
+
+    return mm;
+}
+
+void __bi_mont_enter(bi_word_t *dst, MPI x, bi_mont_ctx_t *ctx, void *ifma) {
+#ifdef BI_HAVE_IFMA
+    if (ifma) {
+        __bi_ifma_to_mont(dst, x, ifma);
+        return;
+    }
+#endif
+    (void)ifma;
+
+    MPI x_mont = bi_to_mont(x, ctx);
+    __bi_mont_load(dst, x_mont, ctx->n->words);
+    bi_free(x_mont);
+}
+
+void __bi_mont_leave(MPI dst, bi_word_t *r, bi_mont_ctx_t *ctx, void *ifma) {
+    uint32_t k = ctx->n->words;
+    __bi_resize(dst, k);
+
+#ifdef BI_HAVE_IFMA
+    if (ifma) {
+        __bi_ifma_from_mont(dst->data, k, r, ifma);
+        __bi_trim(dst);
+        return;
+    }
+#endif
+    (void)ifma;
+
+    // reducing r with zero high words
+    memset(r + k, 0, (k + 1) * sizeof(bi_word_t));
+    __bi_mont_redc(dst->data, r, ctx);
+    __bi_trim(dst);
+}
+
+MPI __bi_mod_multi_exp_mont(MPI *a, MPI *b, uint32_t count, MPI n) {
+    bi_mont_ctx_t ctx;
+    bi_mont_init(&ctx, n);
+    void *ifma = __bi_mont_ifma(&ctx);
+    __bi_modmul_t mm = __bi_mont_modmul(&ctx, ifma);
+    uint32_t k = mm.k;
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *bases = __bi_scratch_alloc((size_t)count * k);
+    bi_word_t *one = __bi_scratch_alloc(k);
+    bi_word_t *r = __bi_scratch_alloc(2 * (size_t)k + 1);
+
+    MPI x = bi_init(ctx.n->words);
+    for (uint32_t i = 0; i < count; i++) {
+        bi_eucl_div_into(NULL, x, a[i], ctx.n);
+        __bi_mont_enter(bases + (size_t)i * k, x, &ctx, ifma);
+    }
+    bi_set(x, 1u);
+    __bi_mont_enter(one, x, &ctx, ifma);
+
+    __bi_multi_exp(r, one, bases, b, count, &mm);
+    __bi_mont_leave(x, r, &ctx, ifma);
+    __bi_scratch_release(mark);
+
+    free(ifma);
+    bi_mont_free(&ctx);
+
+    return x;
+}
+
+// ------ FIXED BASE -----
+
+// Comb teeth for exponents of up to bits bits. Each extra tooth doubles the
+// tables, and cuts the squarings and multiplications by a factor of
+// teeth / (teeth + 1).
+static uint32_t __bi_comb_teeth(uint32_t bits) {
+    if (bits > 1536) {
+        return 8;
+    } else if (bits > 512) {
+        return 7;
+    } else if (bits > 128) {
+        return 6;
+    } else if (bits > 32) {
+        return 4;
+    }
+
+    return 2;
+}
+
+void bi_fixed_base_init(bi_fixed_base_t *fb, MPI base, MPI n,
+                        uint32_t max_bits) {
+    bi_mont_init(&fb->mont, n);
+    fb->ifma = __bi_mont_ifma(&fb->mont);
+
+    fb->base = bi_init(fb->mont.n->words);
+    bi_eucl_div_into(NULL, fb->base, base, fb->mont.n);
+
+    fb->max_bits = max_bits > 0 ? max_bits : 1;
+    fb->teeth = __bi_comb_teeth(fb->max_bits);
+    fb->spacing = (fb->max_bits + fb->teeth - 1) / fb->teeth;
+
+    __bi_modmul_t mm = __bi_mont_modmul(&fb->mont, fb->ifma);
+    fb->table = bi_init((BI_COMB_TABLES << fb->teeth) * mm.k);
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *one = __bi_scratch_alloc(mm.k);
+    bi_word_t *b = __bi_scratch_alloc(mm.k);
+
+    MPI x = bi_init(1);
+    bi_set(x, 1u);
+    __bi_mont_enter(one, x, &fb->mont, fb->ifma);
+    __bi_mont_enter(b, fb->base, &fb->mont, fb->ifma);
+    bi_free(x);
+
+    __bi_comb_build(fb->table->data, one, b, fb->teeth, fb->spacing, &mm);
+    __bi_scratch_release(mark);
+}
+
+void bi_fixed_base_free(bi_fixed_base_t *fb) {
+    bi_mont_free(&fb->mont);
+    free(fb->ifma);
+    bi_free(fb->base);
+    bi_free(fb->table);
+}
+
+void bi_fixed_base_exp_into(MPI dst, MPI e, bi_fixed_base_t *fb) {
+    if (bi_bit_length(e) > fb->max_bits) {
+        MPI res = bi_mod_exp(fb->base, e, fb->mont.n);
+        bi_copy(res, dst);
+        bi_free(res);
+        return;
+    }
+
+    __bi_modmul_t mm = __bi_mont_modmul(&fb->mont, fb->ifma);
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *r = __bi_scratch_alloc(2 * (size_t)mm.k + 1);
+
+    // the first entry of the tables is 1 in their representation
+    __bi_comb_exp(r, fb->table->data, fb->table->data, fb->teeth, fb->spacing,
+                  e, &mm);
+
+    // e has been read in full, so dst can be it
+    __bi_mont_leave(dst, r, &fb->mont, fb->ifma);
+    __bi_scratch_release(mark);
+}
+
+MPI bi_fixed_base_exp(MPI e, bi_fixed_base_t *fb) {
+    MPI res = bi_init(fb->mont.n->words);
+    bi_fixed_base_exp_into(res, e, fb);
+
+    return res;
+}
+
+// ------ CONSTANT TIME -----
+//
+// The kernels from here on back bi_mod_exp_ct. Their loop bounds and memory
+// accesses depend only on k, carries are folded into the next word rather
+// than rippled up with a loop that stops early, and choices are made with
+// masks instead of branches.
+
+// r = u - n if u >= n, otherwise u, where u has k words plus a top word hi
+// of 0 or 1. Both candidates are computed and r picks one with a mask. r must
+// not overlap u.
+static void __bi_mont_csub_ct(bi_word_t *r, const bi_word_t *u, bi_word_t hi,
+                              const bi_word_t *n, uint32_t k) {
+    bi_sdword_t borrow = 0;
+    for (uint32_t i = 0; i < k; i++) {
+        bi_sdword_t d = (bi_sdword_t)u[i] - n[i] + borrow;
+        r[i] = (bi_word_t)d;
+        borrow = d >> BI_WORD_BITS;
+    }
+
+    // hi + borrow is -1 exactly when u < n, which makes keep all ones
+    bi_word_t keep = (bi_word_t)(((bi_sdword_t)hi + borrow) >> BI_WORD_BITS);
+    for (uint32_t i = 0; i < k; i++) {
+        r[i] = (r[i] & ~keep) | (u[i] & keep);
+    }
+}
+
+// As __bi_mont_redc, for t of 2k words. The carry out of each row is held
+// back and added in with the next one, so every row does the same work.
+static void __bi_mont_redc_ct(bi_word_t *r, bi_word_t *t, bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    const bi_word_t *n = ctx->n->data;
+    bi_word_t top = 0;
+
+    for (uint32_t i = 0; i < k; i++) {
+        bi_word_t m = t[i] * ctx->n_inv;
+        bi_word_t carry = __bi_kernels.addmul_1(t + i, n, k, m);
+
+        bi_dword_t s = (bi_dword_t)t[i + k] + carry + top;
+        t[i + k] = (bi_word_t)s;
+        top = (bi_word_t)(s >> BI_WORD_BITS);
+    }
+
+    __bi_mont_csub_ct(r, t + k, top, n, k);
+}
+
+// r = a * b * R^-1 mod n, reducing a row at a time as the product is summed
+// (CIOS), so the running total never grows past k + 2 words. t is scratch
+// space of k + 2 words. r may alias a or b.
+static void __bi_mont_mul_ct(bi_word_t *r, const bi_word_t *a,
+                             const bi_word_t *b, bi_word_t *t,
+                             bi_mont_ctx_t *ctx) {
+    uint32_t k = ctx->n->words;
+    const bi_word_t *n = ctx->n->data;
+    memset(t, 0, (k + 2) * sizeof(bi_word_t));
+
+    for (uint32_t i = 0; i < k; i++) {
+        bi_word_t carry = __bi_kernels.addmul_1(t, a, k, b[i]);
+        bi_dword_t s = (bi_dword_t)t[k] + carry;
+        t[k] = (bi_word_t)s;
+        t[k + 1] = (bi_word_t)(s >> BI_WORD_BITS);
+
+        // add m * n to clear the bottom word, then shift down by a word
+        bi_word_t m = t[0] * ctx->n_inv;
+        carry = __bi_kernels.addmul_1(t, n, k, m);
+        s = (bi_dword_t)t[k] + carry;
+        t[k] = (bi_word_t)s;
+        t[k + 1] += (bi_word_t)(s >> BI_WORD_BITS);
+        memmove(t, t + 1, (k + 1) * sizeof(bi_word_t));
+    }
+
+    __bi_mont_csub_ct(r, t, t[k], n, k);
+}
+
+// r = a * a * R^-1 mod n. t is scratch space of 2k words, and r may alias a.
+static void __bi_mont_sqr_ct(bi_word_t *r, const bi_word_t *a, bi_word_t *t,
+                             bi_mont_ctx_t *ctx) {
+    __bi_sqr_schoolbook(t, a, ctx->n->words);
+    __bi_mont_redc_ct(r, t, ctx);
+}
+
+static void __bi_mont_mul_ct_fn(bi_word_t *r, const bi_word_t *a,
+                                const bi_word_t *b, bi_word_t *t, void *ctx) {
+    __bi_mont_mul_ct(r, a, b, t, ctx);
+}
+
+static void __bi_mont_sqr_ct_fn(bi_word_t *r, const bi_word_t *a,
+                                bi_word_t *t, void *ctx) {
+    __bi_mont_sqr_ct(r, a, t, ctx);
+}
+
+MPI bi_mod_exp_ct(MPI a, MPI b, MPI n) {
+#ifdef BI_HAVE_IFMA
+    if (__bi_ifma_usable(n)) {
+        return __bi_mod_exp_ifma(a, b, n, true);
+    }
+#endif
+
+    bi_mont_ctx_t ctx;
+    bi_mont_init(&ctx, n);
+    uint32_t k = ctx.n->words;
+
+    __bi_modmul_t mm = {
+        .k = k,
+        .scratch_words = 2 * (size_t)k + 2,
+        .mul = __bi_mont_mul_ct_fn,
+        .sqr = __bi_mont_sqr_ct_fn,
+        .ctx = &ctx,
+    };
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *one = __bi_scratch_alloc(k);
+    bi_word_t *base = __bi_scratch_alloc(k);
+    bi_word_t *t = __bi_scratch_alloc(mm.scratch_words);
+
+    // 1 and a in Montgomery form. The base is public, so it's fine to bring
+    // it in with the ordinary kernels.
+    MPI x = bi_init(1);
+    bi_set(x, 1u);
+    MPI x_mont = bi_to_mont(x, &ctx);
+    __bi_mont_load(one, x_mont, k);
+    bi_free(x_mont);
+
+    x_mont = bi_to_mont(a, &ctx);
+    __bi_mont_load(base, x_mont, k);
+    bi_free(x_mont);
+    bi_free(x);
+
+    MPI res = bi_init(k);
+    __bi_window_exp_ct(res->data, one, base, b, &mm);
+
+    // out of Montgomery form by multiplying by 1
+    memset(one, 0, k * sizeof(bi_word_t));
+    one[0] = 1u;
+    __bi_mont_mul_ct(res->data, res->data, one, t, &ctx);
+    __bi_scratch_release(mark);
+
+    __bi_trim(res);
+    bi_mont_free(&ctx);
+
+    return res;
+}
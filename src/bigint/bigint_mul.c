@@ -0,0 +1,385 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+// r = -r, as an n word two's complement value
+static void __bi_negate_words(bi_word_t *r, uint32_t n) {
+    bi_dword_t carry = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        carry += (bi_word_t)~r[i];
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+}
+
+// r >>= 1, treating r as an n word two's complement value
+static void __bi_sar1_words(bi_word_t *r, uint32_t n) {
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        r[i] = (r[i] >> 1) | (r[i + 1] << (BI_WORD_BITS - 1));
+    }
+    r[n - 1] = (r[n - 1] >> 1) | (r[n - 1] & BI_WORD_TOP_BIT);
+}
+
+// r /= 3 for an n word value known to be a multiple of 3. This is a 2-adic
+// division (multiply by 3^-1 mod 2^w, word by word from the bottom), so it
+// also works on negative two's complement values.
+static void __bi_divexact3_words(bi_word_t *r, uint32_t n) {
+    const bi_word_t inv3 = BI_WORD_MAX / 3 * 2 + 1; // 3 * inv3 = 1 mod 2^w
+    bi_word_t borrow = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        bi_word_t s = r[i] - borrow;
+        bi_word_t under = r[i] < borrow;
+        bi_word_t q = s * inv3;
+        r[i] = q;
+        borrow = under + (bi_word_t)(((bi_dword_t)q * 3u) >> BI_WORD_BITS);
+    }
+}
+
+// r = |a - b| for n word a and b, returning true if a < b
+static bool __bi_abs_diff_words(bi_word_t *r, const bi_word_t *a,
+                                const bi_word_t *b, uint32_t n) {
+    bool neg = __bi_cmp_words(a, b, n) < 0;
+    if (neg) {
+        __bi_sub_words(r, b, n, a, n);
+    } else {
+        __bi_sub_words(r, a, n, b, n);
+    }
+
+    return neg;
+}
+
+// r = a * b, where a has n words, b has m > 0 words and r has n + m words.
+// Linear convolution, a row of a * b[i] at a time:
+// https://www.hvks.com/Numerical/Downloads/HVE%20The%20Math%20behind%20arbitrary%20precision.pdf
+// page 11/12
+static void __bi_mul_schoolbook(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                                const bi_word_t *b, uint32_t m) {
+    r[n] = __bi_kernels.mul_1(r, a, n, b[0]);
+    for (uint32_t i = 1; i < m; i++) {
+        r[i + n] = __bi_kernels.addmul_1(r + i, a, n, b[i]);
+    }
+}
+
+// r = a^2, where a has n words and r has 2n words. Each cross product
+// a[i] * a[j] appears twice in the square, so we sum the upper triangle once,
+// double it with a shift, and then add in the diagonal a[i]^2 terms. Nothing
+// here branches on the data, which bi_mod_exp_ct relies on.
+void __bi_sqr_schoolbook(bi_word_t *r, const bi_word_t *a, uint32_t n) {
+    // row i covers words 2i + 1 up to i + n, all of which the rows before it
+    // have already written
+    r[0] = 0;
+    r[n] = __bi_kernels.mul_1(r + 1, a + 1, n - 1, a[0]);
+    for (uint32_t i = 1; i < n; i++) {
+        r[i + n] =
+            __bi_kernels.addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    }
+
+    bi_word_t shifted = 0;
+    bi_dword_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        bi_dword_t sq = (bi_dword_t)a[i] * a[i];
+        bi_word_t lo = r[2 * i];
+        bi_word_t hi = r[2 * i + 1];
+
+        carry += (bi_dword_t)((lo << 1) | shifted) + (bi_word_t)sq;
+        r[2 * i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+
+        carry += (bi_dword_t)((hi << 1) | (lo >> (BI_WORD_BITS - 1))) +
+                 (sq >> BI_WORD_BITS);
+        r[2 * i + 1] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+
+        shifted = hi >> (BI_WORD_BITS - 1);
+    }
+}
+
+// Words of scratch space __bi_karatsuba or __bi_karatsuba_sqr needs for n
+// word operands
+static size_t __bi_karatsuba_scratch(uint32_t n) {
+    uint32_t threshold = BI_KARATSUBA_THRESHOLD < BI_KARATSUBA_SQR_THRESHOLD
+                             ? BI_KARATSUBA_THRESHOLD
+                             : BI_KARATSUBA_SQR_THRESHOLD;
+    size_t words = 0;
+    while (n >= threshold) {
+        uint32_t m = n - n / 2;
+        words += 4 * ((size_t)m + 1);
+        n = m + 1;
+    }
+
+    return words;
+}
+
+// r = a * b, where a and b have n words, and r has 2n words.
+//
+// With a = a1 * B^h + a0 and b = b1 * B^h + b0:
+//   a * b = z2 * B^2h + z1 * B^h + z0
+// where z0 = a0 * b0, z2 = a1 * b1 and
+//   z1 = (a0 + a1)(b0 + b1) - z0 - z2
+// which is three half size products instead of four.
+static void __bi_karatsuba(bi_word_t *r, const bi_word_t *a, const bi_word_t *b,
+                           uint32_t n, bi_word_t *scratch) {
+    if (n < BI_KARATSUBA_THRESHOLD) {
+        __bi_mul_schoolbook(r, a, n, b, n);
+        return;
+    }
+
+    uint32_t h = n / 2;
+    uint32_t m = n - h;
+
+    bi_word_t *sa = scratch;
+    bi_word_t *sb = sa + m + 1;
+    bi_word_t *z1 = sb + m + 1;
+    bi_word_t *next = z1 + 2 * (m + 1);
+
+    sa[m] = __bi_add_words(sa, a + h, m, a, h);
+    sb[m] = __bi_add_words(sb, b + h, m, b, h);
+
+    __bi_karatsuba(r, a, b, h, next);
+    __bi_karatsuba(r + 2 * h, a + h, b + h, m, next);
+    __bi_karatsuba(z1, sa, sb, m + 1, next);
+
+    __bi_sub_words_in_place(z1, 2 * (m + 1), r, 2 * h);
+    __bi_sub_words_in_place(z1, 2 * (m + 1), r + 2 * h, 2 * m);
+
+    // z1 < B^(2m + 1), so its top word is always zero
+    __bi_add_words_in_place(r + h, 2 * n - h, z1, 2 * m + 1);
+}
+
+// r = a^2, where a has n words, and r has 2n words. Karatsuba with a single
+// operand, so all three half size products are squares:
+//   z1 = (a0 + a1)^2 - a0^2 - a1^2
+// Needs no more scratch than __bi_karatsuba.
+static void __bi_karatsuba_sqr(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                               bi_word_t *scratch) {
+    if (n < BI_KARATSUBA_SQR_THRESHOLD) {
+        __bi_sqr_schoolbook(r, a, n);
+        return;
+    }
+
+    uint32_t h = n / 2;
+    uint32_t m = n - h;
+
+    bi_word_t *sa = scratch;
+    bi_word_t *z1 = sa + m + 1;
+    bi_word_t *next = z1 + 2 * (m + 1);
+
+    sa[m] = __bi_add_words(sa, a + h, m, a, h);
+
+    __bi_karatsuba_sqr(r, a, h, next);
+    __bi_karatsuba_sqr(r + 2 * h, a + h, m, next);
+    __bi_karatsuba_sqr(z1, sa, m + 1, next);
+
+    __bi_sub_words_in_place(z1, 2 * (m + 1), r, 2 * h);
+    __bi_sub_words_in_place(z1, 2 * (m + 1), r + 2 * h, 2 * m);
+
+    __bi_add_words_in_place(r + h, 2 * n - h, z1, 2 * m + 1);
+}
+
+// Evaluates the three way split x = x2 * B^2k + x1 * B^k + x0 of an n word
+// value at the Toom-3 points. Each output has k + 1 words; negative values
+// are returned as magnitudes, with the sign in *neg_m1 / *neg_m2.
+static void __bi_toom3_eval(const bi_word_t *x, uint32_t n, uint32_t k,
+                            bi_word_t *p1, bi_word_t *pm1, bool *neg_m1,
+                            bi_word_t *pm2, bool *neg_m2, bi_word_t *tmp) {
+    const bi_word_t *x0 = x;
+    const bi_word_t *x1 = x + k;
+    const bi_word_t *x2 = x + 2 * k;
+    uint32_t k2 = n - 2 * k;
+
+    // tmp = x0 + x2
+    tmp[k] = __bi_add_words(tmp, x0, k, x2, k2);
+
+    // p(1) = x0 + x1 + x2
+    memcpy(p1, tmp, (k + 1) * sizeof(bi_word_t));
+    __bi_add_words_in_place(p1, k + 1, x1, k);
+
+    // p(-1) = x0 - x1 + x2
+    memcpy(pm1, x1, k * sizeof(bi_word_t));
+    pm1[k] = 0;
+    *neg_m1 = __bi_abs_diff_words(pm1, tmp, pm1, k + 1);
+
+    // p(-2) = x0 - 2 x1 + 4 x2 = (x0 + 4 x2) - 2 x1
+    memset(tmp, 0, (k + 1) * sizeof(bi_word_t));
+    for (uint32_t i = 0; i < k2; i++) {
+        tmp[i] = x2[i] << 2;
+        if (i > 0) {
+            tmp[i] |= x2[i - 1] >> (BI_WORD_BITS - 2);
+        }
+    }
+    tmp[k2] |= x2[k2 - 1] >> (BI_WORD_BITS - 2);
+    __bi_add_words_in_place(tmp, k + 1, x0, k);
+
+    for (uint32_t i = 0; i < k; i++) {
+        pm2[i] = x1[i] << 1;
+        if (i > 0) {
+            pm2[i] |= x1[i - 1] >> (BI_WORD_BITS - 1);
+        }
+    }
+    pm2[k] = x1[k - 1] >> (BI_WORD_BITS - 1);
+    *neg_m2 = __bi_abs_diff_words(pm2, tmp, pm2, k + 1);
+}
+
+// r = a * b, where a and b have n words, and r has 2n words.
+//
+// Splits each operand into three parts and treats them as polynomials in
+// B^k. The product polynomial has 5 coefficients, so we evaluate at 0, 1,
+// -1, -2 and infinity, take 5 products of a third of the size, and
+// interpolate back (Bodrato's sequence). When a == b only one operand is
+// evaluated, and the five products recurse as squares.
+static void __bi_toom3(bi_word_t *r, const bi_word_t *a, const bi_word_t *b,
+                       uint32_t n) {
+    uint32_t k = (n + 2) / 3;
+    uint32_t k2 = n - 2 * k;
+    uint32_t l = 2 * k + 2;
+
+    size_t mark = __bi_scratch_mark();
+    bi_word_t *buf = __bi_scratch_alloc(7 * ((size_t)k + 1) + 3 * (size_t)l);
+    bi_word_t *pa1 = buf;
+    bi_word_t *pam1 = pa1 + k + 1;
+    bi_word_t *pam2 = pam1 + k + 1;
+    bi_word_t *pb1 = pam2 + k + 1;
+    bi_word_t *pbm1 = pb1 + k + 1;
+    bi_word_t *pbm2 = pbm1 + k + 1;
+    bi_word_t *tmp = pbm2 + k + 1;
+    bi_word_t *w1 = tmp + k + 1;
+    bi_word_t *wm1 = w1 + l;
+    bi_word_t *wm2 = wm1 + l;
+
+    bool a_neg_m1, a_neg_m2, b_neg_m1, b_neg_m2;
+    __bi_toom3_eval(a, n, k, pa1, pam1, &a_neg_m1, pam2, &a_neg_m2, tmp);
+    if (a == b) {
+        pb1 = pa1;
+        pbm1 = pam1;
+        pbm2 = pam2;
+        b_neg_m1 = a_neg_m1;
+        b_neg_m2 = a_neg_m2;
+    } else {
+        __bi_toom3_eval(b, n, k, pb1, pbm1, &b_neg_m1, pbm2, &b_neg_m2, tmp);
+    }
+
+    // w(0) and w(inf) go straight into place, leaving r[2k..4k) zero
+    bi_word_t *w0 = r;
+    bi_word_t *winf = r + 4 * k;
+    __bi_mul_words(w0, a, k, b, k);
+    memset(r + 2 * k, 0, 2 * (size_t)k * sizeof(bi_word_t));
+    __bi_mul_words(winf, a + 2 * k, k2, b + 2 * k, k2);
+
+    __bi_mul_words(w1, pa1, k + 1, pb1, k + 1);
+    __bi_mul_words(wm1, pam1, k + 1, pbm1, k + 1);
+    if (a_neg_m1 != b_neg_m1) {
+        __bi_negate_words(wm1, l);
+    }
+    __bi_mul_words(wm2, pam2, k + 1, pbm2, k + 1);
+    if (a_neg_m2 != b_neg_m2) {
+        __bi_negate_words(wm2, l);
+    }
+
+    // Interpolation, as l word two's complement values:
+    //   r3 = (w(-2) - w(1)) / 3
+    //   r1 = (w(1) - w(-1)) / 2
+    //   r2 = w(-1) - w(0)
+    //   r3 = (r2 - r3) / 2 + 2 w(inf)
+    //   r2 = r2 + r1 - w(inf)
+    //   r1 = r1 - r3
+    bi_word_t *r1 = w1;
+    bi_word_t *r2 = wm1;
+    bi_word_t *r3 = wm2;
+
+    __bi_sub_words(r3, wm2, l, w1, l);
+    __bi_divexact3_words(r3, l);
+
+    __bi_sub_words(r1, w1, l, wm1, l);
+    __bi_sar1_words(r1, l);
+
+    __bi_sub_words_in_place(r2, l, w0, 2 * k);
+
+    __bi_sub_words(r3, r2, l, r3, l);
+    __bi_sar1_words(r3, l);
+    __bi_add_words_in_place(r3, l, winf, 2 * k2);
+    __bi_add_words_in_place(r3, l, winf, 2 * k2);
+
+    __bi_add_words_in_place(r2, l, r1, l);
+    __bi_sub_words_in_place(r2, l, winf, 2 * k2);
+
+    __bi_sub_words_in_place(r1, l, r3, l);
+
+    // The coefficients are all non-negative and the total fits in 2n words,
+    // so any words that would land past the end of r are zero.
+    __bi_add_words_in_place(r + k, 2 * n - k, r1, l);
+    __bi_add_words_in_place(r + 2 * k, 2 * n - 2 * k, r2, l);
+    __bi_add_words_in_place(r + 3 * k, 2 * n - 3 * k, r3,
+                            l < 2 * n - 3 * k ? l : 2 * n - 3 * k);
+
+    __bi_scratch_release(mark);
+}
+
+void __bi_sqr_words(bi_word_t *r, const bi_word_t *a, uint32_t n) {
+    if (n < BI_KARATSUBA_SQR_THRESHOLD) {
+        __bi_sqr_schoolbook(r, a, n);
+    } else if (n >= BI_NTT_THRESHOLD && 2 * (size_t)n <= BI_NTT_MAX_WORDS) {
+        __bi_mul_ntt(r, a, n, a, n);
+    } else if (n >= BI_TOOM3_THRESHOLD) {
+        __bi_toom3(r, a, a, n);
+    } else {
+        size_t mark = __bi_scratch_mark();
+        bi_word_t *scratch = __bi_scratch_alloc(__bi_karatsuba_scratch(n));
+        __bi_karatsuba_sqr(r, a, n, scratch);
+        __bi_scratch_release(mark);
+    }
+}
+
+void __bi_mul_words(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                    const bi_word_t *b, uint32_t m) {
+    if (a == b && n == m) {
+        __bi_sqr_words(r, a, n);
+        return;
+    }
+
+    if (n < m) {
+        const bi_word_t *tmp = a;
+        a = b;
+        b = tmp;
+
+        uint32_t tmp_words = n;
+        n = m;
+        m = tmp_words;
+    }
+
+    // invariant: n >= m
+    if (m < BI_KARATSUBA_THRESHOLD) {
+        __bi_mul_schoolbook(r, a, n, b, m);
+        return;
+    }
+
+    if (m >= BI_NTT_THRESHOLD && n + m <= BI_NTT_MAX_WORDS) {
+        __bi_mul_ntt(r, a, n, b, m);
+        return;
+    }
+
+    size_t mark = __bi_scratch_mark();
+
+    if (n != m) {
+        // unbalanced, so multiply b by m word chunks of a and add the
+        // partial products into place
+        bi_word_t *scratch = __bi_scratch_alloc(2 * (size_t)m);
+
+        memset(r, 0, (size_t)(n + m) * sizeof(bi_word_t));
+        for (uint32_t off = 0; off < n; off += m) {
+            uint32_t len = n - off < m ? n - off : m;
+            __bi_mul_words(scratch, a + off, len, b, m);
+            __bi_add_words_in_place(r + off, n + m - off, scratch, len + m);
+        }
+    } else if (n >= BI_TOOM3_THRESHOLD) {
+        __bi_toom3(r, a, b, n);
+    } else {
+        bi_word_t *scratch = __bi_scratch_alloc(__bi_karatsuba_scratch(n));
+        __bi_karatsuba(r, a, b, n, scratch);
+    }
+
+    __bi_scratch_release(mark);
+}
@@ -0,0 +1,270 @@
+#include <bigint/bigint.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+/*
+ * Multiplication by number theoretic transform, for very large operands.
+ *
+ * Operands are cut into 16 bit digits and convolved modulo three primes of
+ * the form c * 2^k + 1, which all have roots of unity of order up to 2^26.
+ * Each convolution coefficient is below 2^26 * 2^32 = 2^58, much less than
+ * the product of the primes (~2^90), so CRT recovers every coefficient
+ * exactly. Carries are then propagated back into whole words.
+ */
+
+#define BI_NTT_PRIMES 3
+#define BI_NTT_DIGIT_BITS 16
+#define BI_NTT_DIGIT_MASK 0xFFFFu
+#define BI_NTT_DIGITS_PER_WORD (BI_WORD_BITS / BI_NTT_DIGIT_BITS)
+
+// Words in a 64 bit constant, and in the CRT accumulator, whose 128 bits
+// hold a coefficient below p0 * p1 * p2 plus the carry into it
+#define BI_NTT_U64_WORDS (64 / BI_WORD_BITS)
+#define BI_NTT_ACC_WORDS (128 / BI_WORD_BITS)
+
+typedef struct {
+    uint32_t p;
+    uint32_t g; // primitive root mod p
+} __bi_ntt_prime_t;
+
+static const __bi_ntt_prime_t ntt_primes[BI_NTT_PRIMES] = {
+    {2013265921u, 31u}, // 15 * 2^27 + 1
+    {1811939329u, 13u}, // 27 * 2^26 + 1
+    {469762049u, 3u},   // 7 * 2^26 + 1
+};
+
+static uint32_t __bi_ntt_pow(uint32_t b, uint64_t e, uint32_t p) {
+    uint64_t res = 1;
+    uint64_t base = b % p;
+    while (e) {
+        if (e & 1u) {
+            res = res * base % p;
+        }
+        base = base * base % p;
+        e >>= 1;
+    }
+
+    return (uint32_t)res;
+}
+
+// Montgomery arithmetic mod p < 2^31, with R = 2^32. redc(a * (bR)) = ab,
+// so keeping the twiddles in Montgomery form lets us multiply plain values
+// with a single reduction.
+static inline uint32_t __bi_ntt_redc(uint64_t t, uint32_t p, uint32_t p_inv) {
+    uint32_t m = (uint32_t)t * p_inv;
+    uint32_t u = (uint32_t)((t + (uint64_t)m * p) >> 32);
+    return u >= p ? u - p : u;
+}
+
+static inline uint32_t __bi_ntt_mul(uint32_t a, uint32_t b, uint32_t p,
+                                    uint32_t p_inv) {
+    return __bi_ntt_redc((uint64_t)a * b, p, p_inv);
+}
+
+static inline uint32_t __bi_ntt_add(uint32_t a, uint32_t b, uint32_t p) {
+    uint32_t s = a + b;
+    return s >= p ? s - p : s;
+}
+
+static inline uint32_t __bi_ntt_sub(uint32_t a, uint32_t b, uint32_t p) {
+    return a >= b ? a - b : a + p - b;
+}
+
+// roots[len + j] = w^j * R mod p for each level len = 1, 2, 4, ... N/2,
+// where w is a primitive 2len-th root of unity (or its inverse)
+static void __bi_ntt_roots(uint32_t *roots, uint32_t n, uint32_t p,
+                           uint32_t g, bool inverse) {
+    for (uint32_t len = 1; len < n; len <<= 1) {
+        uint32_t w = __bi_ntt_pow(g, (p - 1) / (2 * len), p);
+        if (inverse) {
+            w = __bi_ntt_pow(w, p - 2, p);
+        }
+
+        uint64_t curr = ((uint64_t)1 << 32) % p;
+        for (uint32_t j = 0; j < len; j++) {
+            roots[len + j] = (uint32_t)curr;
+            curr = curr * w % p;
+        }
+    }
+}
+
+// Decimation in frequency: natural order in, bit reversed order out
+static void __bi_ntt_forward(uint32_t *x, uint32_t n, const uint32_t *roots,
+                             uint32_t p, uint32_t p_inv) {
+    for (uint32_t len = n / 2; len >= 1; len >>= 1) {
+        for (uint32_t i = 0; i < n; i += 2 * len) {
+            for (uint32_t j = 0; j < len; j++) {
+                uint32_t u = x[i + j];
+                uint32_t v = x[i + j + len];
+                x[i + j] = __bi_ntt_add(u, v, p);
+                x[i + j + len] =
+                    __bi_ntt_mul(__bi_ntt_sub(u, v, p), roots[len + j], p,
+                                 p_inv);
+            }
+        }
+    }
+}
+
+// Decimation in time: bit reversed order in, natural order out
+static void __bi_ntt_inverse(uint32_t *x, uint32_t n, const uint32_t *roots,
+                             uint32_t p, uint32_t p_inv) {
+    for (uint32_t len = 1; len < n; len <<= 1) {
+        for (uint32_t i = 0; i < n; i += 2 * len) {
+            for (uint32_t j = 0; j < len; j++) {
+                uint32_t u = x[i + j];
+                uint32_t v = __bi_ntt_mul(x[i + j + len], roots[len + j], p,
+                                          p_inv);
+                x[i + j] = __bi_ntt_add(u, v, p);
+                x[i + j + len] = __bi_ntt_sub(u, v, p);
+            }
+        }
+    }
+}
+
+static void __bi_ntt_load(uint32_t *x, uint32_t len, const bi_word_t *a,
+                          uint32_t n) {
+    uint32_t digits = n * BI_NTT_DIGITS_PER_WORD;
+    for (uint32_t i = 0; i < digits; i++) {
+        x[i] = (uint32_t)(a[i / BI_NTT_DIGITS_PER_WORD] >>
+                          (BI_NTT_DIGIT_BITS * (i % BI_NTT_DIGITS_PER_WORD))) &
+               BI_NTT_DIGIT_MASK;
+    }
+    memset(x + digits, 0, (size_t)(len - digits) * sizeof(uint32_t));
+}
+
+// Cyclic convolution of the digits of a and b modulo prime, into res
+static void __bi_ntt_convolve(uint32_t *res, uint32_t *tmp, uint32_t *roots,
+                              uint32_t len, const bi_word_t *a, uint32_t n,
+                              const bi_word_t *b, uint32_t m,
+                              const __bi_ntt_prime_t *prime) {
+    uint32_t p = prime->p;
+
+    // -p^-1 mod 2^32, by Newton iteration
+    uint32_t inv = p;
+    for (int i = 0; i < 4; i++) {
+        inv *= 2u - p * inv;
+    }
+    uint32_t p_inv = (uint32_t)0 - inv;
+
+    __bi_ntt_roots(roots, len, p, prime->g, false);
+    __bi_ntt_load(res, len, a, n);
+    __bi_ntt_forward(res, len, roots, p, p_inv);
+
+    // The pointwise products pick up a factor of R^-1, so the final scaling
+    // multiplies by len^-1 * R (kept in Montgomery form as len^-1 * R^2).
+    // Squares only need the one forward transform.
+    if (a == b && n == m) {
+        for (uint32_t i = 0; i < len; i++) {
+            res[i] = __bi_ntt_mul(res[i], res[i], p, p_inv);
+        }
+    } else {
+        __bi_ntt_load(tmp, len, b, m);
+        __bi_ntt_forward(tmp, len, roots, p, p_inv);
+
+        for (uint32_t i = 0; i < len; i++) {
+            res[i] = __bi_ntt_mul(res[i], tmp[i], p, p_inv);
+        }
+    }
+
+    __bi_ntt_roots(roots, len, p, prime->g, true);
+    __bi_ntt_inverse(res, len, roots, p, p_inv);
+
+    uint64_t r = ((uint64_t)1 << 32) % p;
+    uint32_t scale = (uint32_t)((uint64_t)__bi_ntt_pow(len, p - 2, p) * r %
+                                p * r % p);
+    for (uint32_t i = 0; i < len; i++) {
+        res[i] = __bi_ntt_mul(res[i], scale, p, p_inv);
+    }
+}
+
+// x as BI_NTT_U64_WORDS words, least significant first
+static void __bi_ntt_u64_words(bi_word_t *r, uint64_t x) {
+    for (uint32_t i = 0; i < BI_NTT_U64_WORDS; i++) {
+        r[i] = (bi_word_t)x;
+        // in two halves, since a whole word shift is out of range for 64
+        // bit words
+        x >>= BI_WORD_BITS / 2;
+        x >>= BI_WORD_BITS / 2;
+    }
+}
+
+// acc += x * y, for x below 2^32 and y with BI_NTT_U64_WORDS words
+static inline void __bi_ntt_acc_add(bi_word_t *acc, uint32_t x,
+                                    const bi_word_t *y) {
+    bi_word_t carry = __bi_kernels.addmul_1(acc, y, BI_NTT_U64_WORDS, x);
+    __bi_add_words_in_place(acc + BI_NTT_U64_WORDS,
+                            BI_NTT_ACC_WORDS - BI_NTT_U64_WORDS, &carry, 1);
+}
+
+void __bi_mul_ntt(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                  const bi_word_t *b, uint32_t m) {
+    uint32_t digits = BI_NTT_DIGITS_PER_WORD * (n + m);
+    uint32_t len = 1;
+    while (len < digits - 1) {
+        len <<= 1;
+    }
+
+    uint32_t *buf = malloc((size_t)(BI_NTT_PRIMES + 2) * len *
+                           sizeof(uint32_t));
+    if (buf == NULL) {
+        fprintf(stderr, "FATAL: out of memory in __bi_mul_ntt\n");
+        exit(1);
+    }
+    uint32_t *res[BI_NTT_PRIMES];
+    for (uint32_t i = 0; i < BI_NTT_PRIMES; i++) {
+        res[i] = buf + (size_t)i * len;
+    }
+    uint32_t *tmp = buf + (size_t)BI_NTT_PRIMES * len;
+    uint32_t *roots = tmp + len;
+
+    for (uint32_t i = 0; i < BI_NTT_PRIMES; i++) {
+        __bi_ntt_convolve(res[i], tmp, roots, len, a, n, b, m, &ntt_primes[i]);
+    }
+
+    // Garner's algorithm: x = x0 + x1 * p0 + x2 * p0 * p1
+    const uint64_t p0 = ntt_primes[0].p;
+    const uint64_t p1 = ntt_primes[1].p;
+    const uint64_t p2 = ntt_primes[2].p;
+    const uint64_t p0_inv_p1 = __bi_ntt_pow(p0 % p1, p1 - 2, p1);
+    const uint64_t p0p1_inv_p2 = __bi_ntt_pow(p0 * p1 % p2, p2 - 2, p2);
+
+    // the sum goes through the word kernels, so it needs no integer type
+    // wider than the limbs
+    bi_word_t p0p1_words[BI_NTT_U64_WORDS];
+    __bi_ntt_u64_words(p0p1_words, p0 * p1);
+
+    bi_word_t acc[BI_NTT_ACC_WORDS] = {0};
+    for (uint32_t i = 0; i < digits; i++) {
+        if (i < len) {
+            uint64_t x0 = res[0][i];
+            uint64_t x1 = (res[1][i] + p1 - x0 % p1) % p1 * p0_inv_p1 % p1;
+            uint64_t x01 = (x0 + x1 * (p0 % p2)) % p2;
+            uint64_t x2 = (res[2][i] + p2 - x01) % p2 * p0p1_inv_p2 % p2;
+
+            // x0 + x1 * p0 is below 2^63, so only the last term needs
+            // more than 64 bits
+            bi_word_t low[BI_NTT_U64_WORDS];
+            __bi_ntt_u64_words(low, x0 + x1 * p0);
+            __bi_add_words_in_place(acc, BI_NTT_ACC_WORDS, low,
+                                    BI_NTT_U64_WORDS);
+            __bi_ntt_acc_add(acc, (uint32_t)x2, p0p1_words);
+        }
+
+        bi_word_t digit = acc[0] & BI_NTT_DIGIT_MASK;
+        __bi_shr_bits(acc, acc, BI_NTT_ACC_WORDS, BI_NTT_DIGIT_BITS);
+
+        uint32_t shift = BI_NTT_DIGIT_BITS * (i % BI_NTT_DIGITS_PER_WORD);
+        if (shift == 0) {
+            r[i / BI_NTT_DIGITS_PER_WORD] = digit;
+        } else {
+            r[i / BI_NTT_DIGITS_PER_WORD] |= digit << shift;
+        }
+    }
+
+    free(buf);
+}
@@ -0,0 +1,109 @@
+#include <bigint/bigint.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bigint_internal.h"
+
+/*
+ * Per thread stack of scratch words for temporaries that don't outlive the
+ * operation that made them. Allocations are a pointer bump, and releasing back
+ * to a mark is O(1).
+ *
+ * Words are addressed by a running offset across a chain of blocks, so a
+ * block never moves once handed out. When the arena empties after having had
+ * to chain blocks, it is rebuilt as one block of the peak size seen, so an
+ * operation that's repeated fits in a single block without touching the heap
+ * again.
+ */
+
+// Smallest block worth asking the heap for
+#define BI_SCRATCH_MIN_WORDS 4096
+
+typedef struct __bi_scratch_block {
+    struct __bi_scratch_block *prev;
+    size_t start; // offset of data[0]
+    size_t words;
+    bi_word_t data[];
+} __bi_scratch_block_t;
+
+typedef struct {
+    __bi_scratch_block_t *top;
+    size_t used;
+    size_t peak;
+} __bi_scratch_t;
+
+static _Thread_local __bi_scratch_t arena;
+
+static void __bi_scratch_push(size_t words) {
+    __bi_scratch_block_t *block =
+        malloc(sizeof(__bi_scratch_block_t) + words * sizeof(bi_word_t));
+    if (block == NULL) {
+        fprintf(stderr, "FATAL: out of memory for bigint scratch space\n");
+        exit(1);
+    }
+
+    block->prev = arena.top;
+    block->start = arena.used;
+    block->words = words;
+    arena.top = block;
+}
+
+static void __bi_scratch_pop(void) {
+    __bi_scratch_block_t *block = arena.top;
+    arena.top = block->prev;
+    free(block);
+}
+
+size_t __bi_scratch_mark(void) { return arena.used; }
+
+bi_word_t *__bi_scratch_alloc(size_t words) {
+    __bi_scratch_block_t *top = arena.top;
+
+    if (top == NULL || arena.used + words > top->start + top->words) {
+        size_t block_words = words;
+        if (top != NULL && block_words < 2 * top->words) {
+            block_words = 2 * top->words;
+        }
+        if (block_words < BI_SCRATCH_MIN_WORDS) {
+            block_words = BI_SCRATCH_MIN_WORDS;
+        }
+
+        __bi_scratch_push(block_words);
+        top = arena.top;
+    }
+
+    bi_word_t *res = top->data + (arena.used - top->start);
+    arena.used += words;
+    if (arena.used > arena.peak) {
+        arena.peak = arena.used;
+    }
+
+    return res;
+}
+
+void __bi_scratch_release(size_t mark) {
+    arena.used = mark;
+
+    // blocks pushed after the mark are empty now
+    while (arena.top != NULL && arena.top->prev != NULL &&
+           arena.top->start >= mark) {
+        __bi_scratch_pop();
+    }
+
+    // once empty, swap the first block for one that fits the whole peak
+    if (mark == 0 && arena.top != NULL && arena.top->words < arena.peak) {
+        __bi_scratch_pop();
+        __bi_scratch_push(arena.peak);
+    }
+}
+
+void bi_scratch_free(void) {
+    while (arena.top != NULL) {
+        __bi_scratch_pop();
+    }
+
+    arena.used = 0;
+    arena.peak = 0;
+}
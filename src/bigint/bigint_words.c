@@ -0,0 +1,166 @@
+#include <bigint/bigint.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bigint_internal.h"
+
+/*
+ * The word level primitives everything else is built on: addition,
+ * subtraction, single word multiplies, shifts and comparison of raw word
+ * arrays. None of them allocate or know about MPI, so the multiply,
+ * division, Montgomery and Barrett code, and the MPI operations themselves,
+ * all share the same carry loops.
+ */
+
+bi_word_t __bi_add_words(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                         const bi_word_t *b, uint32_t m) {
+    bi_dword_t carry = 0;
+    for (uint32_t i = 0; i < m; i++) {
+        carry += (bi_dword_t)a[i] + b[i];
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+
+    for (uint32_t i = m; i < n; i++) {
+        carry += a[i];
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+
+    return (bi_word_t)carry;
+}
+
+bi_word_t __bi_sub_words(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                         const bi_word_t *b, uint32_t m) {
+    bi_sdword_t borrow = 0;
+    for (uint32_t i = 0; i < m; i++) {
+        borrow += (bi_sdword_t)a[i] - b[i];
+        r[i] = (bi_word_t)borrow;
+        borrow >>= BI_WORD_BITS;
+    }
+
+    for (uint32_t i = m; i < n; i++) {
+        borrow += a[i];
+        r[i] = (bi_word_t)borrow;
+        borrow >>= BI_WORD_BITS;
+    }
+
+    return (bi_word_t)(borrow != 0);
+}
+
+bi_word_t __bi_add_words_in_place(bi_word_t *r, uint32_t n, const bi_word_t *b,
+                                  uint32_t m) {
+    bi_dword_t carry = 0;
+    for (uint32_t i = 0; i < m; i++) {
+        carry += (bi_dword_t)r[i] + b[i];
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+
+    for (uint32_t i = m; carry && i < n; i++) {
+        carry += r[i];
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+
+    return (bi_word_t)carry;
+}
+
+bi_word_t __bi_sub_words_in_place(bi_word_t *r, uint32_t n, const bi_word_t *b,
+                                  uint32_t m) {
+    bi_sdword_t borrow = 0;
+    for (uint32_t i = 0; i < m; i++) {
+        borrow += (bi_sdword_t)r[i] - b[i];
+        r[i] = (bi_word_t)borrow;
+        borrow >>= BI_WORD_BITS;
+    }
+
+    for (uint32_t i = m; borrow && i < n; i++) {
+        borrow += r[i];
+        r[i] = (bi_word_t)borrow;
+        borrow >>= BI_WORD_BITS;
+    }
+
+    return (bi_word_t)(borrow != 0);
+}
+
+bi_word_t __bi_mul_1(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                     bi_word_t b) {
+    bi_dword_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        carry += (bi_dword_t)a[i] * b;
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+
+    return (bi_word_t)carry;
+}
+
+bi_word_t __bi_addmul_1(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        bi_word_t b) {
+    // a * b + r + carry < B^2, so this never overflows the double word
+    bi_dword_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        carry += (bi_dword_t)a[i] * b + r[i];
+        r[i] = (bi_word_t)carry;
+        carry >>= BI_WORD_BITS;
+    }
+
+    return (bi_word_t)carry;
+}
+
+bi_word_t __bi_submul_1(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        bi_word_t b) {
+    bi_word_t borrow = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        bi_dword_t p = (bi_dword_t)a[i] * b + borrow;
+        bi_word_t lo = (bi_word_t)p;
+        bi_word_t x = r[i];
+        r[i] = x - lo;
+        borrow = (bi_word_t)(p >> BI_WORD_BITS) + (x < lo);
+    }
+
+    return borrow;
+}
+
+bi_word_t __bi_shl_bits(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        uint32_t s) {
+    if (s == 0) {
+        memmove(r, a, (size_t)n * sizeof(bi_word_t));
+        return 0;
+    }
+
+    bi_word_t out = a[n - 1] >> (BI_WORD_BITS - s);
+    for (uint32_t i = n - 1; i > 0; i--) {
+        r[i] = (a[i] << s) | (a[i - 1] >> (BI_WORD_BITS - s));
+    }
+    r[0] = a[0] << s;
+
+    return out;
+}
+
+bi_word_t __bi_shr_bits(bi_word_t *r, const bi_word_t *a, uint32_t n,
+                        uint32_t s) {
+    if (s == 0) {
+        memmove(r, a, (size_t)n * sizeof(bi_word_t));
+        return 0;
+    }
+
+    bi_word_t out = a[0] << (BI_WORD_BITS - s);
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        r[i] = (a[i] >> s) | (a[i + 1] << (BI_WORD_BITS - s));
+    }
+    r[n - 1] = a[n - 1] >> s;
+
+    return out;
+}
+
+int __bi_cmp_words(const bi_word_t *a, const bi_word_t *b, uint32_t n) {
+    for (uint32_t i = n; i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] > b[i] ? 1 : -1;
+        }
+    }
+
+    return 0;
+}
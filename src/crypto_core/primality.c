@@ -6,24 +6,10 @@
 
 struct mr_sd miller_rabin_sd(MPI n) {
     MPI s = bi_init_like(n);
-    MPI tmp_two = bi_init_like(n);
-    bi_set(tmp_two, 2u);
-    MPI tmp_zero = bi_init_like(n);
-    bi_set(tmp_zero, 0u);
 
     MPI d = bi_init_and_copy(n);
     bi_dec(d);
-
-    MPI tmp;
-    while (bi_even(d)) {
-        bi_eucl_div(d, tmp_two, &tmp, NULL);
-        bi_copy(tmp, d);
-        bi_free(tmp);
-        bi_inc(s);
-    }
-
-    bi_free(tmp_two);
-    bi_free(tmp_zero);
+    bi_set(s, bi_strip_trailing_zeros(d));
 
     return (struct mr_sd){
         .s = s,
@@ -33,8 +19,13 @@ struct mr_sd miller_rabin_sd(MPI n) {
 
 MPI miller_rabin_randn(MPI n) {
     // assumption: n is already squeezed
-    uint32_t leading_zeros = __builtin_clz(n->data[n->words - 1]);
-    uint32_t mask = (uint32_t)(32ull - 1) >> (leading_zeros + 1);
+    uint32_t leading_zeros = BI_WORD_BITS * n->words - bi_bit_length(n);
+
+    // all ones below the top bit of n. When n's top word is 1 that's no bits
+    // at all, and the shift would be the full word width.
+    bi_word_t mask = leading_zeros + 1 < BI_WORD_BITS
+                         ? ~(bi_word_t)0 >> (leading_zeros + 1)
+                         : 0u;
 
     MPI a = will_rng_next(n->words);
 
@@ -53,39 +44,73 @@ MPI miller_rabin_randn(MPI n) {
     return a;
 }
 
-bool __miller_rabin_inner_check(MPI n, MPI a, struct mr_sd sd) {
-    MPI tmp_two = bi_init_like(n);
-    bi_set(tmp_two, 2u);
+/*
+ * What every witness for one n shares, built once per miller_rabin call: the
+ * Montgomery context for n, and 1 and n - 1 in Montgomery form for the
+ * squarings to be compared against
+ */
+typedef struct {
+    bi_mont_ctx_t mont;
+    MPI one;         // 1 in Montgomery form
+    MPI n_minus_one; // n - 1 in Montgomery form
+} __mr_ctx_t;
+
+static void __mr_ctx_init(__mr_ctx_t *ctx, MPI n) {
+    bi_mont_init(&ctx->mont, n);
+
+    MPI x = bi_init(1);
+    bi_set(x, 1u);
+    ctx->one = bi_to_mont(x, &ctx->mont);
+    bi_free(x);
+
+    x = bi_init_and_copy(ctx->mont.n);
+    bi_dec(x);
+    ctx->n_minus_one = bi_to_mont(x, &ctx->mont);
+    bi_free(x);
+}
 
-    MPI tmp_n_minus_one = bi_init_and_copy(n);
-    bi_dec(tmp_n_minus_one);
+static void __mr_ctx_free(__mr_ctx_t *ctx) {
+    bi_free(ctx->one);
+    bi_free(ctx->n_minus_one);
+    bi_mont_free(&ctx->mont);
+}
 
-    MPI x = bi_mod_exp(a, sd.d, n);
+// true if a isn't a witness to n being composite
+static bool __mr_check(__mr_ctx_t *ctx, MPI a, struct mr_sd sd) {
+    // x = a^d, which stays in Montgomery form through the squarings
+    MPI a_mont = bi_to_mont(a, &ctx->mont);
+    MPI x = bi_mont_exp(a_mont, sd.d, &ctx->mont);
+    bi_free(a_mont);
 
+    bool res = true;
     MPI s_ = bi_init_like(sd.d);
     bi_set(s_, 0u);
     for (; bi_lt(s_, sd.s); bi_inc(s_)) {
-        MPI y = bi_mod_exp(x, tmp_two, n);
+        bool was_pm_one = bi_eq(x, ctx->one) || bi_eq(x, ctx->n_minus_one);
+        bi_mont_sqr_into(x, x, &ctx->mont);
 
-        if (bi_eq_val(y, 1u) && !bi_eq_val(x, 1u) &&
-            !bi_eq(x, tmp_n_minus_one)) {
+        if (!was_pm_one && bi_eq(x, ctx->one)) {
             // nontrivial square root of 1 modulo n
-            bi_free(tmp_two);
-            bi_free(tmp_n_minus_one);
-            bi_free(x);
-            bi_free(s_);
-            return false;
+            res = false;
+            break;
         }
+    }
 
-        bi_copy(y, x);
-        bi_free(y);
+    if (res) {
+        res = bi_eq(x, ctx->one);
     }
 
-    bi_free(tmp_two);
-    bi_free(tmp_n_minus_one);
-    bi_free(s_);
-    bool res = bi_eq_val(x, 1);
     bi_free(x);
+    bi_free(s_);
+    return res;
+}
+
+bool __miller_rabin_inner_check(MPI n, MPI a, struct mr_sd sd) {
+    __mr_ctx_t ctx;
+    __mr_ctx_init(&ctx, n);
+    bool res = __mr_check(&ctx, a, sd);
+
+    __mr_ctx_free(&ctx);
     return res;
 }
 
@@ -128,15 +153,15 @@ bool miller_rabin(MPI n, int k) {
     // start off by testing the first few primes
     uint32_t n_first_primes = sizeof(first_primes) / sizeof(uint32_t);
 
-    MPI res, a;
+    MPI a = bi_init(1);
+    MPI res = bi_init(1);
 
     for (uint32_t i = 0; i < n_first_primes; i++) {
-        a = bi_init(1);
         a->data[0] = first_primes[i];
 
         // for small a, it's faster to do a
         // division than an actual miller rabin test
-        bi_eucl_div(n, a, NULL, &res);
+        bi_eucl_div_into(NULL, res, n, a);
 
         if (bi_eq_val(res, 0)) {
             bi_free(sd.s);
@@ -145,42 +170,43 @@ bool miller_rabin(MPI n, int k) {
             bi_free(res);
             return false;
         }
-
-        bi_free(a);
-        bi_free(res);
     }
 
+    bi_free(a);
+    bi_free(res);
+
     if (k < n_first_primes) {
         bi_free(sd.s);
         bi_free(sd.d);
         return true;
     }
 
-    for (int k_ = 0; k_ < k - n_first_primes; k_++) {
+    // every trial shares the one Montgomery context
+    __mr_ctx_t ctx;
+    __mr_ctx_init(&ctx, n);
+
+    bool probably_prime = true;
+    for (int k_ = 0; probably_prime && k_ < k - n_first_primes; k_++) {
         // Sets a with a random number betwee 2 and n-2
         a = miller_rabin_randn(n);
 
         if (a == NULL) {
             bi_free(sd.s);
             bi_free(sd.d);
+            __mr_ctx_free(&ctx);
 
             printf("ERROR: Miller-Rabin RNG failed (trial %d/%d)\n", k_, k);
             exit(1);
         }
 
-        if (!__miller_rabin_inner_check(n, a, sd)) {
-            bi_free(sd.s);
-            bi_free(sd.d);
-            bi_free(a);
-            return false;
-        }
-
+        probably_prime = __mr_check(&ctx, a, sd);
         bi_free(a);
     }
 
+    __mr_ctx_free(&ctx);
     bi_free(sd.s);
     bi_free(sd.d);
-    return true;
+    return probably_prime;
 }
 
 MPI gen_prime(uint32_t words) {
@@ -41,21 +41,22 @@ int rsa_mode_from_str(char *str, rsa_mode_t *res) {
 
 void load_new_primes(rsa_state_t *new_state, uint32_t seed, rsa_mode_t mode,
                      MPI e) {
-    uint32_t prime_words;
+    uint32_t prime_bits;
     switch (mode) {
     case RSA_MODE_1024:
-        prime_words = 16;
+        prime_bits = 512;
         break;
     case RSA_MODE_512:
-        prime_words = 8;
+        prime_bits = 256;
         break;
     case RSA_MODE_2048:
-        prime_words = 32;
+        prime_bits = 1024;
         break;
     case RSA_MODE_4096:
-        prime_words = 64;
+        prime_bits = 2048;
         break;
     }
+    uint32_t prime_words = prime_bits / BI_WORD_BITS;
 
     will_rng_init(seed);
 
@@ -296,5 +297,6 @@ MPI will_rsa_encrypt_num(MPI input, rsa_public_token_t *key) {
 }
 
 MPI will_rsa_decrypt_num(MPI input, rsa_private_token_t *key) {
-    return bi_mod_exp(input, key->d, key->n);
+    // d is secret, so don't let the timing depend on its bits
+    return bi_mod_exp_ct(input, key->d, key->n);
 }
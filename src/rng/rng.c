@@ -37,25 +37,18 @@ MPI will_rng_next(uint32_t words) {
 
     MPI res = bi_init(words);
 
-    if (words < 16) {
-        uint32_t tmp[16] = {0};
-        chacha_block(tmp, rng_state.prev);
-        memcpy(rng_state.prev, tmp, 16 * sizeof(uint32_t));
-        memcpy(res->data, tmp, words * sizeof(uint32_t));
-        return res;
-    }
+    // chacha works in 32 bit chunks, so fill the limbs chunk by chunk,
+    // chaining each block off the previous one
+    size_t chunks = (size_t)words * (sizeof(bi_word_t) / sizeof(uint32_t));
+    uint32_t *out = (uint32_t *)res->data;
 
-    for (uint32_t i = 0; i < res->words; i += 16) {
-        chacha_block(&(res->data[i]), rng_state.prev);
-        memcpy(rng_state.prev, &(res->data[i]), 16 * sizeof(uint32_t));
-    }
-
-    if (words % 16 != 0) {
+    for (size_t i = 0; i < chunks; i += 16) {
         uint32_t tmp[16] = {0};
         chacha_block(tmp, rng_state.prev);
         memcpy(rng_state.prev, tmp, 16 * sizeof(uint32_t));
-        memcpy(&(res->data[words - (words % 16)]), tmp,
-               (words % 16) * sizeof(uint32_t));
+
+        size_t n = chunks - i < 16 ? chunks - i : 16;
+        memcpy(out + i, tmp, n * sizeof(uint32_t));
     }
 
     return res;
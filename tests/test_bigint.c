@@ -14,6 +14,81 @@
 
 #include "test_suites.h"
 
+void test_bi_barrett(void) {
+    // cross-check Barrett products against bi_mul + bi_eucl_div, for even and
+    // odd moduli of a range of sizes
+    will_rng_init(4321u);
+
+    for (uint32_t words = 1; words <= 40; words++) {
+        MPI n = will_rng_next(words);
+        n->data[words - 1] |= 1u;
+        if (words % 2 == 0) {
+            n->data[0] &= ~(bi_word_t)1u;
+        }
+
+        // powers of the word base have the largest possible mu
+        MPI n_pow = bi_init(words);
+        n_pow->data[words - 1] = 1u;
+
+        MPI mods[] = {n, n_pow};
+        for (uint32_t m = 0; m < 2; m++) {
+            bi_barrett_ctx_t ctx;
+            bi_barrett_init(&ctx, mods[m]);
+
+            MPI a_raw = will_rng_next(2 * words);
+            MPI b_raw = will_rng_next(3 * words);
+            MPI a, b;
+            bi_eucl_div(a_raw, mods[m], NULL, &a);
+            bi_eucl_div(b_raw, mods[m], NULL, &b);
+
+            // both the single step and the division fallback
+            MPI a_got = bi_barrett_mod(a_raw, &ctx);
+            MPI b_got = bi_barrett_mod(b_raw, &ctx);
+            CU_ASSERT(bi_eq(a_got, a));
+            CU_ASSERT(bi_eq(b_got, b));
+
+            MPI ab = bi_mul(a, b);
+            MPI expected;
+            bi_eucl_div(ab, mods[m], NULL, &expected);
+            MPI got = bi_mod_mul(a, b, &ctx);
+
+            bool pass = bi_eq(got, expected);
+            CU_ASSERT(pass);
+            if (!pass) {
+                printf("words=%u\nn=", words);
+                bi_print(mods[m]);
+                printf("\na=");
+                bi_print(a);
+                printf("\nb=");
+                bi_print(b);
+                printf("\n\n");
+            }
+
+            MPI aa = bi_sqr(a);
+            MPI aa_expected;
+            bi_eucl_div(aa, mods[m], NULL, &aa_expected);
+            bi_mod_sqr_into(a, a, &ctx);
+            CU_ASSERT(bi_eq(a, aa_expected));
+
+            bi_free(a_raw);
+            bi_free(b_raw);
+            bi_free(a);
+            bi_free(b);
+            bi_free(a_got);
+            bi_free(b_got);
+            bi_free(ab);
+            bi_free(expected);
+            bi_free(got);
+            bi_free(aa);
+            bi_free(aa_expected);
+            bi_barrett_free(&ctx);
+        }
+
+        bi_free(n);
+        bi_free(n_pow);
+    }
+}
+
 void test_bi_gcd(void) {
     //   a_words, a[0]..,  b_words, b[0]..,  expected_words, expected[0]..
     // clang-format off
@@ -36,20 +111,11 @@ void test_bi_gcd(void) {
 
     uint32_t curr = 0;
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr++];
+        MPI a = test_table_bi(tests, &curr);
 
-        uint32_t b_words = tests[curr++];
-        MPI b = bi_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b->data[j] = tests[curr++];
+        MPI b = test_table_bi(tests, &curr);
 
-        uint32_t e_words = tests[curr++];
-        MPI expected = bi_init(e_words);
-        for (uint32_t j = 0; j < e_words; j++)
-            expected->data[j] = tests[curr++];
+        MPI expected = test_table_bi(tests, &curr);
 
         MPI got = bi_gcd(a, b);
 
@@ -96,20 +162,11 @@ void test_bi_lcm(void) {
 
     uint32_t curr = 0;
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr++];
+        MPI a = test_table_bi(tests, &curr);
 
-        uint32_t b_words = tests[curr++];
-        MPI b = bi_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b->data[j] = tests[curr++];
+        MPI b = test_table_bi(tests, &curr);
 
-        uint32_t e_words = tests[curr++];
-        MPI expected = bi_init(e_words);
-        for (uint32_t j = 0; j < e_words; j++)
-            expected->data[j] = tests[curr++];
+        MPI expected = test_table_bi(tests, &curr);
 
         MPI got = bi_lcm(a, b);
 
@@ -155,43 +212,15 @@ void test_bi_mod_exp(void) {
     uint32_t curr_pos = 0;
 
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos];
-        MPI a = bi_init(a_words);
-        curr_pos++;
+        MPI a = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t j = 0; j < a_words; j++) {
-            a->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI b = test_table_bi(tests, &curr_pos);
 
-        uint32_t b_words = tests[curr_pos];
-        MPI b = bi_init(b_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < b_words; j++) {
-            b->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t m_words = tests[curr_pos];
-        MPI m = bi_init(m_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < m_words; j++) {
-            m->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI m = test_table_bi(tests, &curr_pos);
 
         MPI res = bi_mod_exp(a, b, m);
 
-        uint32_t expected_res_words = tests[curr_pos];
-        MPI expected_res = bi_init(expected_res_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < expected_res_words; j++) {
-            expected_res->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI expected_res = test_table_bi(tests, &curr_pos);
 
         bool pass = bi_eq(res, expected_res);
 
@@ -218,6 +247,577 @@ void test_bi_mod_exp(void) {
     }
 }
 
+void test_bi_mod_exp_exponent_split(void) {
+    // a^(e1 + e2) = a^e1 * a^e2 mod n, for exponent lengths that cover every
+    // window size and for both odd and even moduli
+    will_rng_init(4321u);
+
+    uint32_t exp_words[] = {1, 2, 4, 8, 16, 24};
+    for (uint32_t i = 0; i < sizeof(exp_words) / sizeof(uint32_t); i++) {
+        for (uint32_t odd = 0; odd < 2; odd++) {
+            MPI n = will_rng_next(8);
+            if (odd) {
+                n->data[0] |= 1u;
+            } else {
+                n->data[0] &= ~1u;
+            }
+
+            MPI a = will_rng_next(8);
+            MPI e1 = will_rng_next(exp_words[i]);
+            MPI e2 = will_rng_next(exp_words[i]);
+            MPI e = bi_add(e1, e2);
+
+            MPI lhs = bi_mod_exp(a, e, n);
+            MPI r1 = bi_mod_exp(a, e1, n);
+            MPI r2 = bi_mod_exp(a, e2, n);
+            MPI r1r2 = bi_mul(r1, r2);
+            MPI rhs;
+            bi_eucl_div(r1r2, n, NULL, &rhs);
+
+            bool pass = bi_eq(lhs, rhs);
+            CU_ASSERT(pass);
+            if (!pass) {
+                printf("exp words=%u, odd=%u\na=", exp_words[i], odd);
+                bi_print(a);
+                printf("\nn=");
+                bi_print(n);
+                printf("\ne1=");
+                bi_print(e1);
+                printf("\ne2=");
+                bi_print(e2);
+                printf("\n\n");
+            }
+
+            bi_free(n);
+            bi_free(a);
+            bi_free(e1);
+            bi_free(e2);
+            bi_free(e);
+            bi_free(lhs);
+            bi_free(r1);
+            bi_free(r2);
+            bi_free(r1r2);
+            bi_free(rhs);
+        }
+    }
+
+    MPI x = bi_init(3);
+    x->data[1] = 0x00008001;
+    CU_ASSERT(bi_bit_length(x) == BI_WORD_BITS + 16);
+    CU_ASSERT(bi_test_bit(x, BI_WORD_BITS));
+    CU_ASSERT(!bi_test_bit(x, BI_WORD_BITS + 1));
+    CU_ASSERT(bi_test_bit(x, BI_WORD_BITS + 15));
+    CU_ASSERT(!bi_test_bit(x, 200));
+    bi_set(x, 0);
+    CU_ASSERT(bi_bit_length(x) == 0);
+    bi_free(x);
+}
+
+void test_bi_mod_exp_ct(void) {
+    // cross-check the constant time path against bi_mod_exp, including
+    // exponents with leading zero words and moduli of all ones, which push
+    // the most values through the final subtraction
+    will_rng_init(2468u);
+
+    for (uint32_t words = 1; words <= 40; words += 3) {
+        MPI n = will_rng_next(words);
+        n->data[0] |= 1u;
+        n->data[words - 1] |= 1u;
+
+        MPI n_ones = bi_init(words);
+        for (uint32_t i = 0; i < words; i++) {
+            n_ones->data[i] = ~(bi_word_t)0;
+        }
+
+        MPI mods[] = {n, n_ones};
+        for (uint32_t m = 0; m < 2; m++) {
+            MPI a = will_rng_next(words + 1);
+            MPI e = will_rng_next(words);
+            MPI e_padded = bi_pad_words(e, 2);
+
+            MPI expected = bi_mod_exp(a, e, mods[m]);
+            MPI got = bi_mod_exp_ct(a, e, mods[m]);
+            MPI got_padded = bi_mod_exp_ct(a, e_padded, mods[m]);
+
+            bool pass = bi_eq(got, expected) && bi_eq(got_padded, expected);
+            CU_ASSERT(pass);
+            if (!pass) {
+                printf("words=%u\nn=", words);
+                bi_print(mods[m]);
+                printf("\na=");
+                bi_print(a);
+                printf("\ne=");
+                bi_print(e);
+                printf("\n\n");
+            }
+
+            bi_free(a);
+            bi_free(e);
+            bi_free(e_padded);
+            bi_free(expected);
+            bi_free(got);
+            bi_free(got_padded);
+        }
+
+        bi_free(n);
+        bi_free(n_ones);
+    }
+
+    // x^0 = 1, and everything is 0 mod 1
+    MPI a = bi_init(1);
+    bi_set(a, 5u);
+    MPI zero = bi_init(2);
+    MPI n = bi_init(1);
+    bi_set(n, 7u);
+
+    MPI res = bi_mod_exp_ct(a, zero, n);
+    CU_ASSERT(bi_eq_val(res, 1u));
+    bi_free(res);
+
+    bi_set(n, 1u);
+    res = bi_mod_exp_ct(a, a, n);
+    CU_ASSERT(bi_eq_val(res, 0u));
+    bi_free(res);
+
+    bi_free(a);
+    bi_free(zero);
+    bi_free(n);
+}
+
+void test_bi_mod_multi_exp(void) {
+    // cross-check against a product of separate bi_mod_exp calls, for odd
+    // and even moduli including ones the IFMA kernels take, exponents of
+    // different lengths, and zero exponents
+    will_rng_init(97531u);
+
+    uint32_t mod_words[] = {1, 3, 8, 17, 2048 / BI_WORD_BITS};
+    for (uint32_t m = 0; m < 5; m++) {
+        uint32_t words = mod_words[m];
+        for (uint32_t odd = 0; odd < 2; odd++) {
+            MPI n = will_rng_next(words);
+            n->data[words - 1] |= (bi_word_t)1 << (BI_WORD_BITS - 1);
+            if (odd) {
+                n->data[0] |= 1u;
+            } else {
+                n->data[0] &= ~(bi_word_t)1;
+            }
+
+            MPI a[4];
+            MPI b[4];
+            for (uint32_t i = 0; i < 4; i++) {
+                a[i] = will_rng_next(words + i % 2);
+                b[i] = will_rng_next(i + 1);
+            }
+            bi_set(b[2], 0u);
+
+            for (uint32_t count = 1; count <= 4; count++) {
+                MPI expected = bi_init(1);
+                bi_set(expected, 1u);
+                for (uint32_t i = 0; i < count; i++) {
+                    MPI p = bi_mod_exp(a[i], b[i], n);
+                    MPI prod = bi_mul(expected, p);
+                    bi_eucl_div_into(NULL, expected, prod, n);
+                    bi_free(p);
+                    bi_free(prod);
+                }
+
+                MPI got = bi_mod_multi_exp(a, b, count, n);
+                bool pass = bi_eq(got, expected);
+                CU_ASSERT(pass);
+                if (!pass) {
+                    printf("words=%u, odd=%u, count=%u\nn=", words, odd,
+                           count);
+                    bi_print(n);
+                    printf("\n\n");
+                }
+
+                bi_free(expected);
+                bi_free(got);
+            }
+
+            bi_free(n);
+            for (uint32_t i = 0; i < 4; i++) {
+                bi_free(a[i]);
+                bi_free(b[i]);
+            }
+        }
+    }
+
+    // the empty product is 1, and everything is 0 mod 1
+    MPI n = bi_init(1);
+    bi_set(n, 7u);
+    MPI res = bi_mod_multi_exp(NULL, NULL, 0, n);
+    CU_ASSERT(bi_eq_val(res, 1u));
+    bi_free(res);
+
+    MPI a = bi_init(1);
+    bi_set(a, 3u);
+    bi_set(n, 1u);
+    res = bi_mod_multi_exp(&a, &a, 1, n);
+    CU_ASSERT(bi_eq_val(res, 0u));
+
+    bi_free(res);
+    bi_free(a);
+    bi_free(n);
+}
+
+void test_bi_mod_exp_batch(void) {
+    // cross-check against one bi_mod_exp at a time, over odd, even and IFMA
+    // sized moduli, with per base and shared exponents, and with fewer,
+    // more and a default number of threads
+    will_rng_init(24680u);
+
+    uint32_t mod_words[] = {2, 9, 1024 / BI_WORD_BITS};
+    uint32_t threads[] = {1, 3, 0, 40};
+    for (uint32_t m = 0; m < 3; m++) {
+        for (uint32_t odd = 0; odd < 2; odd++) {
+            uint32_t words = mod_words[m];
+            MPI n = will_rng_next(words);
+            n->data[words - 1] |= (bi_word_t)1 << (BI_WORD_BITS - 1);
+            if (odd) {
+                n->data[0] |= 1u;
+            } else {
+                n->data[0] &= ~(bi_word_t)1;
+            }
+
+            MPI a[9];
+            MPI b[9];
+            MPI out[9];
+            for (uint32_t i = 0; i < 9; i++) {
+                a[i] = will_rng_next(words + i % 3);
+                b[i] = will_rng_next(1 + i % 4);
+                out[i] = bi_init(1);
+            }
+            bi_set(b[4], 0u);
+            MPI e = will_rng_next(words);
+
+            for (uint32_t t = 0; t < 4; t++) {
+                bi_mod_exp_batch(out, a, b, NULL, 9, n, threads[t]);
+                for (uint32_t i = 0; i < 9; i++) {
+                    MPI expected = bi_mod_exp(a[i], b[i], n);
+                    CU_ASSERT(bi_eq(out[i], expected));
+                    bi_free(expected);
+                }
+
+                bi_mod_exp_batch(out, a, NULL, e, 9, n, threads[t]);
+                for (uint32_t i = 0; i < 9; i++) {
+                    MPI expected = bi_mod_exp(a[i], e, n);
+                    CU_ASSERT(bi_eq(out[i], expected));
+                    bi_free(expected);
+                }
+            }
+
+            // results written over the bases
+            MPI expected[9];
+            for (uint32_t i = 0; i < 9; i++) {
+                expected[i] = bi_mod_exp(a[i], b[i], n);
+            }
+            bi_mod_exp_batch(a, a, b, NULL, 9, n, 2);
+            for (uint32_t i = 0; i < 9; i++) {
+                CU_ASSERT(bi_eq(a[i], expected[i]));
+                bi_free(expected[i]);
+            }
+
+            bi_free(n);
+            bi_free(e);
+            for (uint32_t i = 0; i < 9; i++) {
+                bi_free(a[i]);
+                bi_free(b[i]);
+                bi_free(out[i]);
+            }
+        }
+    }
+
+    // everything is 0 mod 1
+    MPI n = bi_init(1);
+    bi_set(n, 1u);
+    MPI a = bi_init(1);
+    bi_set(a, 3u);
+    MPI out = bi_init(1);
+    bi_set(out, 5u);
+    bi_mod_exp_batch(&out, &a, NULL, a, 1, n, 0);
+    CU_ASSERT(bi_eq_val(out, 0u));
+
+    bi_free(out);
+    bi_free(a);
+    bi_free(n);
+}
+
+void test_bi_fixed_base(void) {
+    // cross-check the comb tables against bi_mod_exp, for exponents below,
+    // at and above the length the tables were built for
+    will_rng_init(8642u);
+
+    for (uint32_t words = 1; words <= 36; words += 5) {
+        MPI n = will_rng_next(words);
+        n->data[0] |= 1u;
+        n->data[words - 1] |= 1u;
+
+        MPI base = will_rng_next(words + 1);
+        uint32_t max_bits = words * BI_WORD_BITS - 3;
+
+        bi_fixed_base_t fb;
+        bi_fixed_base_init(&fb, base, n, max_bits);
+
+        // all ones up to max_bits sets every column of every table
+        MPI ones = bi_init(words);
+        for (uint32_t i = 0; i < words; i++) {
+            ones->data[i] = ~(bi_word_t)0;
+        }
+        bi_shift_right_in_place(ones, 3);
+
+        MPI e = will_rng_next(words);
+        bi_shift_right_in_place(e, 3);
+        MPI small = bi_init(1);
+        bi_set(small, 5u);
+        MPI zero = bi_init(1);
+        MPI longer = will_rng_next(words + 1);
+
+        MPI exps[] = {e, ones, small, zero, longer};
+        for (uint32_t j = 0; j < 5; j++) {
+            MPI expected = bi_mod_exp(base, exps[j], n);
+            MPI got = bi_fixed_base_exp(exps[j], &fb);
+
+            bool pass = bi_eq(got, expected);
+            CU_ASSERT(pass);
+            if (!pass) {
+                printf("words=%u, exponent %u\nn=", words, j);
+                bi_print(n);
+                printf("\nbase=");
+                bi_print(base);
+                printf("\ne=");
+                bi_print(exps[j]);
+                printf("\n\n");
+            }
+
+            bi_free(expected);
+            bi_free(got);
+        }
+
+        // the result can go over the exponent
+        MPI expected = bi_mod_exp(base, e, n);
+        bi_fixed_base_exp_into(e, e, &fb);
+        CU_ASSERT(bi_eq(e, expected));
+        bi_free(expected);
+
+        bi_fixed_base_free(&fb);
+        bi_free(n);
+        bi_free(base);
+        bi_free(ones);
+        bi_free(e);
+        bi_free(small);
+        bi_free(zero);
+        bi_free(longer);
+    }
+
+    // 1024 and 2048 bit moduli, which take the IFMA kernels on CPUs that
+    // have them, checked against the Barrett path through 2n
+    for (uint32_t bits = 1024; bits <= 2048; bits *= 2) {
+        uint32_t words = bits / BI_WORD_BITS;
+        MPI n = will_rng_next(words);
+        n->data[0] |= 1u;
+        n->data[words - 1] |= (bi_word_t)1 << (BI_WORD_BITS - 1);
+        MPI n2 = bi_shift_left(n, 1);
+
+        MPI base = will_rng_next(words);
+        MPI e = will_rng_next(words);
+
+        bi_fixed_base_t fb;
+        bi_fixed_base_init(&fb, base, n, bits);
+
+        MPI ref = bi_mod_exp(base, e, n2);
+        MPI expected;
+        bi_eucl_div(ref, n, NULL, &expected);
+        MPI got = bi_fixed_base_exp(e, &fb);
+        CU_ASSERT(bi_eq(got, expected));
+
+        bi_fixed_base_free(&fb);
+        bi_free(n);
+        bi_free(n2);
+        bi_free(base);
+        bi_free(e);
+        bi_free(ref);
+        bi_free(expected);
+        bi_free(got);
+    }
+
+    // everything is 0 mod 1
+    MPI n = bi_init(1);
+    bi_set(n, 1u);
+    MPI a = bi_init(1);
+    bi_set(a, 3u);
+    bi_fixed_base_t fb;
+    bi_fixed_base_init(&fb, a, n, 8);
+
+    MPI res = bi_fixed_base_exp(a, &fb);
+    CU_ASSERT(bi_eq_val(res, 0u));
+
+    bi_free(res);
+    bi_fixed_base_free(&fb);
+    bi_free(a);
+    bi_free(n);
+}
+
+void test_bi_mod_exp_rsa_sizes(void) {
+    // moduli at and just under 1024, 2048 and 4096 bits, which have their own
+    // kernels on CPUs with AVX-512 IFMA. The reference goes through the even
+    // modulus 2n, which takes the Barrett path instead.
+    will_rng_init(1357u);
+
+    uint32_t sizes[] = {1024, 2048, 4096};
+    for (uint32_t s = 0; s < 3; s++) {
+        for (uint32_t short_by = 0; short_by < 64; short_by += 21) {
+            uint32_t bits = sizes[s] - short_by;
+            uint32_t words = (bits + BI_WORD_BITS - 1) / BI_WORD_BITS;
+            uint32_t top = (bits - 1) % BI_WORD_BITS;
+
+            MPI n = will_rng_next(words);
+            n->data[0] |= 1u;
+            n->data[words - 1] &= ((bi_word_t)2 << top) - 1;
+            n->data[words - 1] |= (bi_word_t)1 << top;
+            MPI n2 = bi_shift_left(n, 1);
+
+            // a random base, 0, n - 1, n, and one bigger than n
+            MPI bases[5];
+            bases[0] = will_rng_next(words);
+            bases[1] = bi_init(1);
+            bases[2] = bi_init_and_copy(n);
+            bi_dec(bases[2]);
+            bases[3] = bi_init_and_copy(n);
+            bases[4] = will_rng_next(words + 2);
+
+            // short exponents keep the reference quick at 4096 bits
+            MPI e = will_rng_next(s == 2 ? 4 : words);
+
+            for (uint32_t i = 0; i < 5; i++) {
+                MPI ref = bi_mod_exp(bases[i], e, n2);
+                MPI expected;
+                bi_eucl_div(ref, n, NULL, &expected);
+
+                MPI got = bi_mod_exp(bases[i], e, n);
+                MPI got_ct = bi_mod_exp_ct(bases[i], e, n);
+
+                bool pass = bi_eq(got, expected) && bi_eq(got_ct, expected);
+                CU_ASSERT(pass);
+                if (!pass) {
+                    printf("bits=%u, base %u\nn=", bits, i);
+                    bi_print(n);
+                    printf("\ne=");
+                    bi_print(e);
+                    printf("\n\n");
+                }
+
+                bi_free(ref);
+                bi_free(expected);
+                bi_free(got);
+                bi_free(got_ct);
+            }
+
+            for (uint32_t i = 0; i < 5; i++) {
+                bi_free(bases[i]);
+            }
+            bi_free(n);
+            bi_free(n2);
+            bi_free(e);
+        }
+    }
+}
+
+void test_bi_mont(void) {
+    // cross-check Montgomery products against bi_mul + bi_eucl_div, for
+    // moduli of a range of sizes
+    will_rng_init(1234u);
+
+    for (uint32_t words = 1; words <= 40; words++) {
+        MPI n = will_rng_next(words);
+        n->data[0] |= 1u;
+        n->data[words - 1] |= 1u;
+
+        MPI a_raw = will_rng_next(words);
+        MPI b_raw = will_rng_next(words + 1);
+        MPI a, b;
+        bi_eucl_div(a_raw, n, NULL, &a);
+        bi_eucl_div(b_raw, n, NULL, &b);
+
+        bi_mont_ctx_t ctx;
+        bi_mont_init(&ctx, n);
+
+        MPI a_mont = bi_to_mont(a, &ctx);
+        MPI b_mont = bi_to_mont(b_raw, &ctx);
+        MPI ab_mont = bi_mont_mul(a_mont, b_mont, &ctx);
+        MPI got = bi_from_mont(ab_mont, &ctx);
+
+        MPI ab = bi_mul(a, b);
+        MPI expected;
+        bi_eucl_div(ab, n, NULL, &expected);
+
+        bool pass = bi_eq(got, expected);
+        CU_ASSERT(pass);
+        if (!pass) {
+            printf("words=%u\nn=", words);
+            bi_print(n);
+            printf("\na=");
+            bi_print(a);
+            printf("\nb=");
+            bi_print(b);
+            printf("\ncalculated (a*b)%%n=");
+            bi_print(got);
+            printf("\nexpected res      =");
+            bi_print(expected);
+            printf("\n\n");
+        }
+
+        // round trip
+        MPI a_back = bi_from_mont(a_mont, &ctx);
+        CU_ASSERT(bi_eq(a_back, a));
+
+        // squaring agrees with multiplying by itself
+        MPI aa_mont = bi_mont_sqr(a_mont, &ctx);
+        MPI aa_mul = bi_mont_mul(a_mont, a_mont, &ctx);
+        CU_ASSERT(bi_eq(aa_mont, aa_mul));
+
+        // in place, with the destination aliasing an operand
+        bi_mont_mul_into(a_mont, a_mont, a_mont, &ctx);
+        CU_ASSERT(bi_eq(a_mont, aa_mul));
+
+        bi_free(aa_mont);
+        bi_free(aa_mul);
+
+        // exponentiation stays in Montgomery form and agrees with
+        // bi_mod_exp, including for a zero exponent
+        MPI e = will_rng_next(words % 3 + 1);
+        MPI b_mont_e = bi_mont_exp(b_mont, e, &ctx);
+        MPI b_e = bi_from_mont(b_mont_e, &ctx);
+        MPI b_e_expected = bi_mod_exp(b, e, n);
+        CU_ASSERT(bi_eq(b_e, b_e_expected));
+
+        bi_set(e, 0u);
+        bi_mont_exp_into(b_mont_e, b_mont, e, &ctx);
+        bi_free(b_e);
+        b_e = bi_from_mont(b_mont_e, &ctx);
+        CU_ASSERT(bi_eq_val(b_e, 1u));
+
+        bi_free(e);
+        bi_free(b_mont_e);
+        bi_free(b_e);
+        bi_free(b_e_expected);
+
+        bi_free(n);
+        bi_free(a_raw);
+        bi_free(b_raw);
+        bi_free(a);
+        bi_free(b);
+        bi_free(a_mont);
+        bi_free(b_mont);
+        bi_free(ab_mont);
+        bi_free(got);
+        bi_free(ab);
+        bi_free(expected);
+        bi_free(a_back);
+        bi_mont_free(&ctx);
+    }
+}
+
 void test_bi_add(void) {
     // clang-format off
     uint32_t tests[] = {
@@ -233,20 +833,11 @@ void test_bi_add(void) {
     uint32_t curr_pos = 0;
     uint32_t test = 0;
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr_pos++];
+        MPI a = test_table_bi(tests, &curr_pos);
 
-        uint32_t b_words = tests[curr_pos++];
-        MPI b = bi_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b->data[j] = tests[curr_pos++];
+        MPI b = test_table_bi(tests, &curr_pos);
 
-        uint32_t exp_words = tests[curr_pos++];
-        MPI expected = bi_init(exp_words);
-        for (uint32_t j = 0; j < exp_words; j++)
-            expected->data[j] = tests[curr_pos++];
+        MPI expected = test_table_bi(tests, &curr_pos);
 
         MPI got = bi_add(a, b);
 
@@ -289,20 +880,11 @@ void test_bi_sub(void) {
     uint32_t curr_pos = 0;
     uint32_t test = 0;
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr_pos++];
+        MPI a = test_table_bi(tests, &curr_pos);
 
-        uint32_t b_words = tests[curr_pos++];
-        MPI b = bi_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b->data[j] = tests[curr_pos++];
+        MPI b = test_table_bi(tests, &curr_pos);
 
-        uint32_t exp_words = tests[curr_pos++];
-        MPI expected = bi_init(exp_words);
-        for (uint32_t j = 0; j < exp_words; j++)
-            expected->data[j] = tests[curr_pos++];
+        MPI expected = test_table_bi(tests, &curr_pos);
 
         MPI got = bi_sub(a, b);
 
@@ -352,17 +934,11 @@ void test_bi_shift_left(void) {
     uint32_t curr_pos = 0;
     uint32_t test = 0;
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr_pos++];
+        MPI a = test_table_bi(tests, &curr_pos);
 
         uint32_t n = tests[curr_pos++];
 
-        uint32_t exp_words = tests[curr_pos++];
-        MPI expected = bi_init(exp_words);
-        for (uint32_t j = 0; j < exp_words; j++)
-            expected->data[j] = tests[curr_pos++];
+        MPI expected = test_table_bi(tests, &curr_pos);
 
         MPI got = bi_shift_left(a, n);
 
@@ -408,35 +984,14 @@ void test_bi_mod(void) {
     uint32_t curr_pos = 0;
 
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos];
-        MPI a = bi_init(a_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < a_words; j++) {
-            a->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t b_words = tests[curr_pos];
-        MPI b = bi_init(b_words);
-        curr_pos++;
+        MPI a = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t j = 0; j < b_words; j++) {
-            b->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI b = test_table_bi(tests, &curr_pos);
 
         MPI res;
         bi_eucl_div(a, b, NULL, &res);
 
-        uint32_t expected_res_words = tests[curr_pos];
-        MPI expected_res = bi_init(expected_res_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < expected_res_words; j++) {
-            expected_res->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI expected_res = test_table_bi(tests, &curr_pos);
 
         bool pass = bi_eq(res, expected_res);
 
@@ -482,34 +1037,13 @@ void test_bi_mul(void) {
     uint32_t test = 0;
 
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos];
-        MPI a = bi_init(a_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < a_words; j++) {
-            a->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t b_words = tests[curr_pos];
-        MPI b = bi_init(b_words);
-        curr_pos++;
+        MPI a = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t j = 0; j < b_words; j++) {
-            b->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI b = test_table_bi(tests, &curr_pos);
 
         MPI res = bi_mul(a, b);
 
-        uint32_t expected_res_words = tests[curr_pos];
-        MPI expected_res = bi_init(expected_res_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < expected_res_words; j++) {
-            expected_res->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI expected_res = test_table_bi(tests, &curr_pos);
 
         bool pass = bi_eq(res, expected_res);
 
@@ -533,6 +1067,462 @@ void test_bi_mul(void) {
         test++;
     }
 }
+void test_bi_mul_large(void) {
+    // sizes either side of the fast multiplication thresholds, checked by
+    // dividing the product back out
+    will_rng_init(98765u);
+
+    // clang-format off
+    uint32_t sizes[] = {
+        // a words, b words
+        31, 31,
+        32, 32,
+        33, 33,
+        64, 64,
+        127, 128,
+        200, 64,
+        300, 37,
+        513, 499,
+        600, 600,
+        1201, 1199,
+        8192, 8192,
+        12001, 8197,
+    };
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(uint32_t); i += 2) {
+        MPI a = will_rng_next(sizes[i]);
+        MPI b = will_rng_next(sizes[i + 1]);
+        b->data[b->words - 1] |= 1u;
+
+        MPI ab = bi_mul(a, b);
+        MPI ba = bi_mul(b, a);
+
+        MPI q, r;
+        bi_eucl_div(ab, b, &q, &r);
+
+        bool pass = bi_eq(ab, ba) && bi_eq(q, a) && bi_eq_val(r, 0);
+        CU_ASSERT(pass);
+        if (!pass) {
+            printf("a words=%u, b words=%u\n", sizes[i], sizes[i + 1]);
+        }
+
+        bi_free(a);
+        bi_free(b);
+        bi_free(ab);
+        bi_free(ba);
+        bi_free(q);
+        bi_free(r);
+    }
+}
+
+void test_bi_div_large(void) {
+    // u = a * v + (v - 1) has a known quotient and remainder, which must come
+    // back on both sides of the recursive division thresholds, with quotients
+    // shorter than, as long as and longer than the divisor
+    will_rng_init(11235u);
+
+    // clang-format off
+    uint32_t sizes[] = {
+        // a words, v words
+        1, 59,
+        59, 60,
+        60, 60,
+        61, 61,
+        3, 200,
+        200, 3,
+        130, 121,
+        121, 250,
+        999, 500,
+        2000, 301,
+        4000, 4001,
+        20000, 10000,
+    };
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(uint32_t); i += 2) {
+        for (uint32_t ones = 0; ones < 2; ones++) {
+            MPI a = will_rng_next(sizes[i]);
+            MPI v = will_rng_next(sizes[i + 1]);
+            v->data[v->words - 1] |= 1u;
+            if (ones) {
+                // quotient estimates from all ones divisors need the most
+                // correcting
+                for (uint32_t j = 0; j < v->words; j++) {
+                    v->data[j] = 0xFFFFFFFFu;
+                }
+            }
+
+            MPI rem = bi_init_and_copy(v);
+            bi_dec(rem);
+            MPI av = bi_mul(a, v);
+            MPI u = bi_add(av, rem);
+
+            MPI q, r;
+            bi_eucl_div(u, v, &q, &r);
+
+            bool pass = bi_eq(q, a) && bi_eq(r, rem);
+            CU_ASSERT(pass);
+            if (!pass) {
+                printf("a words=%u, v words=%u, ones=%u\n", sizes[i],
+                       sizes[i + 1], ones);
+            }
+
+            bi_free(a);
+            bi_free(v);
+            bi_free(rem);
+            bi_free(av);
+            bi_free(u);
+            bi_free(q);
+            bi_free(r);
+        }
+    }
+}
+
+void test_bi_div_ctx(void) {
+    // a prepared divisor must give the same quotients and remainders as
+    // bi_eucl_div, including for dividends below it and when the outputs
+    // are the dividend
+    will_rng_init(8642u);
+
+    // clang-format off
+    uint32_t sizes[] = {
+        // u words, d words
+        1, 1,
+        5, 1,
+        1, 3,
+        2, 2,
+        7, 3,
+        16, 8,
+        64, 32,
+        100, 99,
+        300, 70,
+        260, 130,
+    };
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(uint32_t); i += 2) {
+        MPI d = will_rng_next(sizes[i + 1]);
+        d->data[d->words - 1] |= 1u;
+
+        bi_div_ctx_t ctx;
+        bi_div_init(&ctx, d);
+
+        for (uint32_t j = 0; j < 4; j++) {
+            MPI u = will_rng_next(sizes[i]);
+            if (j == 3) {
+                // all ones words take the quotient B - 1 path
+                for (uint32_t w = 0; w < u->words; w++) {
+                    u->data[w] = 0xFFFFFFFFu;
+                }
+            }
+
+            MPI q_expected, r_expected;
+            bi_eucl_div(u, d, &q_expected, &r_expected);
+
+            MPI q = bi_init(1);
+            MPI r = bi_init(1);
+            bi_div_qr_into(q, r, u, &ctx);
+            MPI r_only = bi_div_mod(u, &ctx);
+
+            MPI q_alias = bi_init_and_copy(u);
+            bi_div_qr_into(q_alias, NULL, q_alias, &ctx);
+            MPI r_alias = bi_init_and_copy(u);
+            bi_div_mod_into(r_alias, r_alias, &ctx);
+
+            bool pass = bi_eq(q, q_expected) && bi_eq(r, r_expected) &&
+                        bi_eq(r_only, r_expected) &&
+                        bi_eq(q_alias, q_expected) &&
+                        bi_eq(r_alias, r_expected);
+            CU_ASSERT(pass);
+            if (!pass) {
+                printf("u words=%u, d words=%u, j=%u\n", sizes[i],
+                       sizes[i + 1], j);
+            }
+
+            bi_free(u);
+            bi_free(q_expected);
+            bi_free(r_expected);
+            bi_free(q);
+            bi_free(r);
+            bi_free(r_only);
+            bi_free(q_alias);
+            bi_free(r_alias);
+        }
+
+        bi_div_free(&ctx);
+        bi_free(d);
+    }
+}
+
+void test_bi_sqr(void) {
+    // squares must match the general product of two distinct copies, across
+    // all of the squaring thresholds
+    will_rng_init(24680u);
+
+    // clang-format off
+    uint32_t sizes[] = {
+        1, 2, 3, 7, 16, 23, 24, 31, 32, 33, 47, 64, 65, 100, 149, 150, 151,
+        257, 512, 1000, 8192,
+    };
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(uint32_t); i++) {
+        MPI a = will_rng_next(sizes[i]);
+        MPI a_copy = bi_init_and_copy(a);
+
+        MPI sq = bi_sqr(a);
+        MPI prod = bi_mul(a, a_copy);
+
+        bool pass = bi_eq(sq, prod);
+        CU_ASSERT(pass);
+        if (!pass) {
+            printf("a words=%u\n", sizes[i]);
+        }
+
+        bi_free(a);
+        bi_free(a_copy);
+        bi_free(sq);
+        bi_free(prod);
+    }
+
+    // all ones words maximise every carry
+    MPI ones = bi_init(40);
+    for (uint32_t i = 0; i < ones->words; i++) {
+        ones->data[i] = 0xFFFFFFFFu;
+    }
+    MPI ones_copy = bi_init_and_copy(ones);
+    MPI sq = bi_sqr(ones);
+    MPI prod = bi_mul(ones, ones_copy);
+    CU_ASSERT(bi_eq(sq, prod));
+
+    bi_free(ones);
+    bi_free(ones_copy);
+    bi_free(sq);
+    bi_free(prod);
+}
+
+void test_bi_into(void) {
+    // every _into op must match its allocating version, whether the
+    // destination is a separate bigint or one of the inputs
+    will_rng_init(13579u);
+
+    // clang-format off
+    uint32_t sizes[][2] = {
+        {1, 1}, {2, 1}, {1, 3}, {5, 5}, {24, 9}, {40, 40}, {151, 150},
+    };
+    uint32_t shifts[] = {0, 1, 31, 32, 33, 95, 200};
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        MPI a = will_rng_next(sizes[i][0]);
+        MPI b = will_rng_next(sizes[i][1]);
+        MPI dst = bi_init(1);
+
+        MPI sum = bi_add(a, b);
+        bi_add_into(dst, a, b);
+        CU_ASSERT(bi_eq(dst, sum));
+
+        MPI a_copy = bi_init_and_copy(a);
+        bi_add_into(a_copy, a_copy, b);
+        CU_ASSERT(bi_eq(a_copy, sum));
+
+        MPI b_copy = bi_init_and_copy(b);
+        bi_add_into(b_copy, a, b_copy);
+        CU_ASSERT(bi_eq(b_copy, sum));
+
+        // sum - b = a, and a - sum clamps to 0
+        bi_sub_into(dst, sum, b);
+        CU_ASSERT(bi_eq(dst, a));
+        bi_sub_into(a_copy, a_copy, b);
+        CU_ASSERT(bi_eq(a_copy, a));
+        bi_sub_into(b_copy, b_copy, b_copy);
+        CU_ASSERT(bi_eq_val(b_copy, 0));
+        bi_sub_into(dst, a, sum);
+        CU_ASSERT(bi_eq_val(dst, 0));
+
+        MPI prod = bi_mul(a, b);
+        bi_mul_into(dst, a, b);
+        CU_ASSERT(bi_eq(dst, prod));
+        bi_copy(b, b_copy);
+        bi_mul_into(b_copy, a, b_copy);
+        CU_ASSERT(bi_eq(b_copy, prod));
+
+        MPI sq = bi_sqr(a);
+        bi_sqr_into(dst, a);
+        CU_ASSERT(bi_eq(dst, sq));
+        bi_sqr_into(a_copy, a_copy);
+        CU_ASSERT(bi_eq(a_copy, sq));
+
+        // q * b + r = a
+        MPI q = bi_init(1);
+        MPI r = bi_init(1);
+        bi_eucl_div_into(q, r, a, b);
+        bi_mul_into(dst, q, b);
+        bi_add_into(dst, dst, r);
+        CU_ASSERT(bi_eq(dst, a));
+        CU_ASSERT(bi_lt(r, b));
+
+        bi_copy(a, a_copy);
+        bi_eucl_div_into(a_copy, NULL, a_copy, b);
+        CU_ASSERT(bi_eq(a_copy, q));
+        bi_copy(b, b_copy);
+        bi_eucl_div_into(NULL, b_copy, a, b_copy);
+        CU_ASSERT(bi_eq(b_copy, r));
+
+        for (uint32_t j = 0; j < sizeof(shifts) / sizeof(uint32_t); j++) {
+            MPI left = bi_shift_left(a, shifts[j]);
+            bi_shift_left_into(dst, a, shifts[j]);
+            CU_ASSERT(bi_eq(dst, left));
+
+            MPI right = bi_shift_right(a, shifts[j]);
+            bi_shift_right_into(dst, a, shifts[j]);
+            CU_ASSERT(bi_eq(dst, right));
+
+            bi_copy(a, a_copy);
+            bi_shift_left_into(a_copy, a_copy, shifts[j]);
+            CU_ASSERT(bi_eq(a_copy, left));
+            bi_shift_right_into(a_copy, a_copy, shifts[j]);
+            CU_ASSERT(bi_eq(a_copy, a));
+
+            bi_free(left);
+            bi_free(right);
+        }
+
+        bi_free(a);
+        bi_free(b);
+        bi_free(dst);
+        bi_free(sum);
+        bi_free(a_copy);
+        bi_free(b_copy);
+        bi_free(prod);
+        bi_free(sq);
+        bi_free(q);
+        bi_free(r);
+    }
+}
+
+void test_bi_carries(void) {
+    // carries and borrows that run the full length, and comparisons that
+    // have to look past leading zero words
+    MPI ones = bi_init(3);
+    for (uint32_t i = 0; i < 3; i++) {
+        ones->data[i] = ~(bi_word_t)0;
+    }
+
+    MPI x = bi_init_and_copy(ones);
+    bi_inc(x);
+    CU_ASSERT(x->words == 4 && x->data[3] == 1 && x->data[0] == 0);
+    bi_dec(x);
+    CU_ASSERT(bi_eq(x, ones));
+
+    MPI zero = bi_init(1);
+    bi_dec(zero);
+    CU_ASSERT(bi_eq_val(zero, 0));
+
+    // ones + 1, with the 1 padded out to more words than ones
+    MPI one = bi_init(5);
+    one->data[0] = 1;
+    MPI sum = bi_add(ones, one);
+    CU_ASSERT(bi_gt(sum, ones) && bi_lt(ones, sum) && bi_ge(sum, sum) &&
+              bi_le(one, ones) && !bi_eq(sum, ones));
+    bi_free(x);
+    x = bi_sub(sum, one);
+    CU_ASSERT(bi_eq(x, ones));
+
+    // shifting across word boundaries and back
+    MPI shl = bi_shift_left(ones, 2 * BI_WORD_BITS + 3);
+    MPI shr = bi_shift_right(shl, 2 * BI_WORD_BITS + 3);
+    CU_ASSERT(bi_eq(shr, ones));
+    CU_ASSERT(bi_bit_length(shl) == 5 * BI_WORD_BITS + 3);
+    bi_shift_left_into(shr, shr, BI_WORD_BITS);
+    bi_shift_right_into(shr, shr, BI_WORD_BITS);
+    CU_ASSERT(bi_eq(shr, ones));
+
+    bi_free(ones);
+    bi_free(x);
+    bi_free(zero);
+    bi_free(one);
+    bi_free(sum);
+    bi_free(shl);
+    bi_free(shr);
+}
+
+void test_bi_shift_in_place(void) {
+    will_rng_init(8642u);
+    uint32_t shifts[] = {0, 1, BI_WORD_BITS - 1, BI_WORD_BITS,
+                         3 * BI_WORD_BITS + 5};
+
+    for (uint32_t i = 0; i < sizeof(shifts) / sizeof(uint32_t); i++) {
+        MPI a = will_rng_next(6);
+        a->data[0] |= 1u;
+        MPI x = bi_init_and_copy(a);
+
+        // trailing zeros across whole words come back out in one go
+        bi_shift_left_in_place(x, shifts[i]);
+        MPI expected = bi_shift_left(a, shifts[i]);
+        CU_ASSERT(bi_eq(x, expected));
+        CU_ASSERT(bi_strip_trailing_zeros(x) == shifts[i]);
+        CU_ASSERT(bi_eq(x, a));
+
+        bi_shift_right_in_place(x, shifts[i]);
+        bi_free(expected);
+        expected = bi_shift_right(a, shifts[i]);
+        CU_ASSERT(bi_eq(x, expected));
+
+        bi_free(a);
+        bi_free(x);
+        bi_free(expected);
+    }
+
+    MPI zero = bi_init(3);
+    CU_ASSERT(bi_strip_trailing_zeros(zero) == 0 && bi_eq_val(zero, 0));
+    bi_free(zero);
+}
+
+void test_bi_storage(void) {
+    // values start out inline, move to the heap as they grow, and keep their
+    // capacity when they shrink again
+    MPI a = bi_init(2);
+    a->data[0] = 0x89abcdefu;
+    a->data[1] = 0x01234567u;
+    MPI orig = bi_init_and_copy(a);
+    CU_ASSERT(a->data == a->inline_data);
+    CU_ASSERT(a->capacity == BI_INLINE_WORDS);
+
+    bi_shift_left_into(a, a, 300);
+    CU_ASSERT(a->data != a->inline_data);
+    CU_ASSERT(a->capacity >= a->words);
+
+    MPI big = bi_init_and_copy(a);
+    CU_ASSERT(big->data != big->inline_data);
+
+    uint32_t capacity = a->capacity;
+    bi_word_t *data = a->data;
+    bi_shift_right_into(a, a, 300);
+    bi_squeeze(a);
+    CU_ASSERT(bi_eq(a, orig));
+    CU_ASSERT(a->words == 2);
+    CU_ASSERT(a->capacity == capacity);
+    CU_ASSERT(a->data == data);
+
+    // copying and setting reuse the storage that's already there
+    bi_copy(orig, big);
+    CU_ASSERT(bi_eq(big, orig));
+    bi_shift_left_into(a, a, 300);
+    CU_ASSERT(a->data == data);
+    bi_copy(a, big);
+    CU_ASSERT(bi_eq(big, a));
+
+    bi_set(big, 7u);
+    CU_ASSERT(bi_eq_val(big, 7u));
+    CU_ASSERT(big->words == 1);
+
+    bi_free(a);
+    bi_free(orig);
+    bi_free(big);
+}
+
 void test_bi_pow(void) {
     // single word first
     MPI a = bi_init(1);
@@ -568,28 +1558,14 @@ void test_bi_pow(void) {
     uint32_t curr_pos = 0;
 
     for (uint32_t i = 0; i < n_tests; i++) {
-        uint32_t a_words = tests[curr_pos];
-        MPI a = bi_init(a_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < a_words; j++) {
-            a->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI a = test_table_bi(tests, &curr_pos);
 
         uint32_t b = tests[curr_pos];
         curr_pos++;
 
         MPI res = bi_pow_imm(a, b);
 
-        uint32_t expected_res_words = tests[curr_pos];
-        MPI expected_res = bi_init(expected_res_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < expected_res_words; j++) {
-            expected_res->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI expected_res = test_table_bi(tests, &curr_pos);
 
         bool pass = bi_eq(res, expected_res);
 
@@ -631,17 +1607,11 @@ void test_bi_shift_right(void) {
 
     uint32_t curr_pos = 0;
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr_pos++];
+        MPI a = test_table_bi(tests, &curr_pos);
 
         uint32_t n = tests[curr_pos++];
 
-        uint32_t exp_words = tests[curr_pos++];
-        MPI expected = bi_init(exp_words);
-        for (uint32_t j = 0; j < exp_words; j++)
-            expected->data[j] = tests[curr_pos++];
+        MPI expected = test_table_bi(tests, &curr_pos);
 
         MPI got = bi_shift_right(a, n);
 
@@ -965,23 +1935,14 @@ void test_ext_euc(void) {
     };
     // clang-format on
 
-    size_t curr = 0;
+    uint32_t curr = 0;
     size_t case_idx = 1;
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr++];
-        MPI a = bi_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a->data[j] = tests[curr++];
+        MPI a = test_table_bi(tests, &curr);
 
-        uint32_t b_words = tests[curr++];
-        MPI b = bi_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b->data[j] = tests[curr++];
+        MPI b = test_table_bi(tests, &curr);
 
-        uint32_t g_words = tests[curr++];
-        MPI expected_gcd = bi_init(g_words);
-        for (uint32_t j = 0; j < g_words; j++)
-            expected_gcd->data[j] = tests[curr++];
+        MPI expected_gcd = test_table_bi(tests, &curr);
 
         ext_euc_res_t res = ext_euc(a, b);
 
@@ -1049,6 +2010,82 @@ void test_ext_euc(void) {
     }
 }
 
+void test_ext_euc_large(void) {
+    // multi-word operands with a known common factor c, so the gcd is c
+    // times the gcd of the cofactors. That must be 1 when one of them is the
+    // other plus one.
+    will_rng_init(97531u);
+
+    // clang-format off
+    uint32_t sizes[] = {
+        // a words, b words, c words
+        2, 2, 1,
+        3, 9, 1,
+        9, 3, 2,
+        16, 16, 4,
+        40, 1, 1,
+        64, 64, 1,
+        64, 63, 8,
+    };
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(uint32_t); i += 3) {
+        MPI a_ = will_rng_next(sizes[i]);
+        MPI c = will_rng_next(sizes[i + 2]);
+        c->data[0] |= 1u;
+
+        MPI b_;
+        if (sizes[i] == sizes[i + 1]) {
+            b_ = bi_init_and_copy(a_);
+            bi_inc(b_);
+        } else {
+            b_ = will_rng_next(sizes[i + 1]);
+        }
+
+        MPI a = bi_mul(a_, c);
+        MPI b = bi_mul(b_, c);
+        ext_euc_res_t res = ext_euc(a, b);
+
+        sMPI signed_a = from_unsigned(a, true);
+        sMPI signed_b = from_unsigned(b, true);
+        sMPI term1 = signed_mul(res.bez_x, signed_a);
+        sMPI term2 = signed_mul(res.bez_y, signed_b);
+        sMPI combo = signed_add(term1, term2);
+
+        // the gcd divides both, and is a * x + b * y
+        MPI a_rem, b_rem;
+        bi_eucl_div(a, res.gcd.val, NULL, &a_rem);
+        bi_eucl_div(b, res.gcd.val, NULL, &b_rem);
+        bool pass = res.gcd.positive && signed_eq(combo, res.gcd) &&
+                    bi_eq_val(a_rem, 0) && bi_eq_val(b_rem, 0);
+        if (sizes[i] == sizes[i + 1]) {
+            pass = pass && bi_eq(res.gcd.val, c);
+        }
+
+        CU_ASSERT(pass);
+        if (!pass) {
+            printf("a words=%u, b words=%u, c words=%u\n", sizes[i],
+                   sizes[i + 1], sizes[i + 2]);
+        }
+
+        bi_free(a_);
+        bi_free(b_);
+        bi_free(c);
+        bi_free(a);
+        bi_free(b);
+        bi_free(a_rem);
+        bi_free(b_rem);
+        signed_free(signed_a);
+        signed_free(signed_b);
+        signed_free(term1);
+        signed_free(term2);
+        signed_free(combo);
+        signed_free(res.bez_x);
+        signed_free(res.bez_y);
+        signed_free(res.gcd);
+    }
+}
+
 void test_bi_mul_inv_mod(void) {
     // clang-format off
     uint32_t tests[] = {
@@ -1091,34 +2128,13 @@ void test_bi_mul_inv_mod(void) {
     uint32_t test = 0;
 
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr_pos];
-        MPI a = bi_init(a_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < a_words; j++) {
-            a->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t b_words = tests[curr_pos];
-        MPI b = bi_init(b_words);
-        curr_pos++;
+        MPI a = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t j = 0; j < b_words; j++) {
-            b->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI b = test_table_bi(tests, &curr_pos);
 
         MPI res = bi_mod_mult_inv(a, b);
 
-        uint32_t expected_res_words = tests[curr_pos];
-        MPI expected_res = bi_init(expected_res_words);
-        curr_pos++;
-
-        for (uint32_t j = 0; j < expected_res_words; j++) {
-            expected_res->data[j] = tests[curr_pos];
-            curr_pos++;
-        }
+        MPI expected_res = test_table_bi(tests, &curr_pos);
 
         bool pass = bi_eq(res, expected_res);
 
@@ -1143,6 +2159,94 @@ void test_bi_mul_inv_mod(void) {
     }
 }
 
+void test_bi_mul_inv_mod_large(void) {
+    // random coprime pairs, against a * x = 1 mod b. Even moduli go by way
+    // of the inverse of b mod a, which is the RSA private exponent case.
+    will_rng_init(24680u);
+
+    // clang-format off
+    uint32_t sizes[] = {
+        // a words, b words, b even
+        1, 1, 0,
+        1, 1, 1,
+        2, 5, 0,
+        5, 2, 0,
+        1, 32, 1,
+        8, 8, 1,
+        16, 16, 0,
+        64, 64, 0,
+        64, 63, 1,
+        3, 64, 1,
+    };
+    // clang-format on
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(uint32_t); i += 3) {
+        MPI a = will_rng_next(sizes[i]);
+        MPI b = will_rng_next(sizes[i + 1]);
+        if (sizes[i + 2]) {
+            b->data[0] &= ~1u;
+            a->data[0] |= 1u;
+        } else {
+            b->data[0] |= 1u;
+        }
+
+        MPI gcd = bi_gcd(a, b);
+        while (!bi_eq_val(gcd, 1)) {
+            bi_add_in_place(a, sizes[i + 2] ? b : gcd);
+            bi_inc(a);
+            if (sizes[i + 2] && bi_even(a)) {
+                bi_inc(a);
+            }
+            bi_free(gcd);
+            gcd = bi_gcd(a, b);
+        }
+
+        MPI x = bi_mod_mult_inv(a, b);
+        MPI ax = bi_mul(a, x);
+        MPI r;
+        bi_eucl_div(ax, b, NULL, &r);
+
+        bool pass = bi_lt(x, b) && bi_eq_val(r, 1);
+        CU_ASSERT(pass);
+        if (!pass) {
+            printf("a words=%u, b words=%u\n", sizes[i], sizes[i + 1]);
+        }
+
+        bi_free(a);
+        bi_free(b);
+        bi_free(gcd);
+        bi_free(x);
+        bi_free(ax);
+        bi_free(r);
+    }
+
+    // the RSA case, with e = 65537 and an even modulus
+    MPI e = bi_init(1);
+    bi_set(e, 65537u);
+    MPI lambda = will_rng_next(64);
+    lambda->data[0] &= ~1u;
+    MPI gcd = bi_gcd(e, lambda);
+    while (!bi_eq_val(gcd, 1)) {
+        bi_inc(lambda);
+        bi_inc(lambda);
+        bi_free(gcd);
+        gcd = bi_gcd(e, lambda);
+    }
+
+    MPI d = bi_mod_mult_inv(e, lambda);
+    MPI ed = bi_mul(e, d);
+    MPI r;
+    bi_eucl_div(ed, lambda, NULL, &r);
+    CU_ASSERT(bi_lt(d, lambda) && bi_eq_val(r, 1));
+
+    bi_free(e);
+    bi_free(lambda);
+    bi_free(gcd);
+    bi_free(d);
+    bi_free(ed);
+    bi_free(r);
+}
+
 CU_pSuite register_bigint_tests(void) {
     CU_pSuite suite = CU_add_suite("BIGINT_Suite", NULL, NULL);
 
@@ -1154,13 +2258,32 @@ CU_pSuite register_bigint_tests(void) {
     CU_add_test(suite, "bi_shift_right", test_bi_shift_right);
     CU_add_test(suite, "bi_shift_left", test_bi_shift_left);
     CU_add_test(suite, "bi_mul", test_bi_mul);
+    CU_add_test(suite, "bi_mul_large", test_bi_mul_large);
+    CU_add_test(suite, "bi_div_large", test_bi_div_large);
+    CU_add_test(suite, "bi_div_ctx", test_bi_div_ctx);
+    CU_add_test(suite, "bi_sqr", test_bi_sqr);
+    CU_add_test(suite, "bi_into", test_bi_into);
+    CU_add_test(suite, "bi_storage", test_bi_storage);
+    CU_add_test(suite, "bi_carries", test_bi_carries);
+    CU_add_test(suite, "bi_shift_in_place", test_bi_shift_in_place);
     CU_add_test(suite, "bi_pow", test_bi_pow);
     CU_add_test(suite, "bi_mod", test_bi_mod);
     CU_add_test(suite, "bi_mod_exp", test_bi_mod_exp);
+    CU_add_test(suite, "bi_mod_exp_exponent_split",
+                test_bi_mod_exp_exponent_split);
+    CU_add_test(suite, "bi_mod_exp_ct", test_bi_mod_exp_ct);
+    CU_add_test(suite, "bi_mod_multi_exp", test_bi_mod_multi_exp);
+    CU_add_test(suite, "bi_mod_exp_batch", test_bi_mod_exp_batch);
+    CU_add_test(suite, "bi_fixed_base", test_bi_fixed_base);
+    CU_add_test(suite, "bi_mod_exp_rsa_sizes", test_bi_mod_exp_rsa_sizes);
+    CU_add_test(suite, "bi_mont", test_bi_mont);
+    CU_add_test(suite, "bi_barrett", test_bi_barrett);
     CU_add_test(suite, "bi_gcd", test_bi_gcd);
     CU_add_test(suite, "bi_lcm", test_bi_lcm);
     CU_add_test(suite, "ext_euc", test_ext_euc);
+    CU_add_test(suite, "ext_euc_large", test_ext_euc_large);
     CU_add_test(suite, "test_bi_mul_inv_mod", test_bi_mul_inv_mod);
+    CU_add_test(suite, "bi_mul_inv_mod_large", test_bi_mul_inv_mod_large);
 
     return suite;
 }
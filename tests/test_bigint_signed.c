@@ -22,7 +22,7 @@ void test_signed_sub(void) {
         2, 0x00000000, 0x00000001, 1, 2, 0x00000001, 0x00000001, 1, 1, 0x00000001, 0,
         3, 0x00000003, 0x00000000, 0x00000001, 0, 1, 0x00000005, 0, 2, 0xFFFFFFFE, 0xFFFFFFFF, 0,
         3, 0x00000001, 0x00000002, 0x00000000, 1, 3, 0x00000001, 0x00000000, 0x00000001, 0, 3, 0x00000002, 0x00000002, 0x00000001, 1,
-        3, 0x00000000, 0x00000002, 0x00000001, 1,  3, 0xFFFFFFFF, 0x00000000, 0x00000001, 1,
+        3, 0x00000000, 0x00000002, 0x00000001, 1,  3, 0xFFFFFFFF, 0x00000000, 0x00000001, 1, 2, 0x00000001, 0x00000001, 1,
         3, 0x0000ABCD, 0x00000000, 0x80000000, 1, 2, 0x0000DCDF, 0x00000000, 1, 3, 0xFFFFCEEE, 0xFFFFFFFF, 0x7FFFFFFF, 1,
         3, 0x00000000, 0x00000002, 0x00000001, 0, 2, 0x00000001, 0x00000001, 0, 3, 0xFFFFFFFF, 0x00000000, 0x00000001, 0,
         3, 0x00000010, 0x00000000, 0x00000001, 0, 3, 0x00000020, 0x00000000, 0x00000000, 1, 3, 0x00000030, 0x00000000, 0x00000001, 0,
@@ -32,31 +32,28 @@ void test_signed_sub(void) {
 
     uint32_t curr = 0;
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr++];
-        sMPI a = signed_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a.val->data[j] = tests[curr++];
-        a.val->words = a_words;
+        sMPI a;
+        a.val = test_table_bi(tests, &curr);
         a.positive = tests[curr++];
 
-        uint32_t b_words = tests[curr++];
-        sMPI b = signed_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b.val->data[j] = tests[curr++];
-        b.val->words = b_words;
+        sMPI b;
+        b.val = test_table_bi(tests, &curr);
         b.positive = tests[curr++];
 
-        uint32_t e_words = tests[curr++];
-        sMPI expected = signed_init(e_words);
-        for (uint32_t j = 0; j < e_words; j++)
-            expected.val->data[j] = tests[curr++];
-        expected.val->words = e_words;
+        sMPI expected;
+        expected.val = test_table_bi(tests, &curr);
         expected.positive = tests[curr++];
 
         sMPI got = signed_sub(a, b);
 
         bool pass = signed_eq(got, expected);
         CU_ASSERT(pass);
+
+        // in place, with the destination aliasing a
+        sMPI a_copy = signed_init_copy(a);
+        signed_sub_into(&a_copy, a_copy, b);
+        CU_ASSERT(signed_eq(a_copy, expected));
+        signed_free(a_copy);
         if (!pass) {
             printf("a=");
             signed_print(a);
@@ -87,22 +84,16 @@ void test_signed_add(void) {
 
     uint32_t curr = 0;
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr++];
-        sMPI a = signed_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a.val->data[j] = tests[curr++];
+        sMPI a;
+        a.val = test_table_bi(tests, &curr);
         a.positive = tests[curr++];
 
-        uint32_t b_words = tests[curr++];
-        sMPI b = signed_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b.val->data[j] = tests[curr++];
+        sMPI b;
+        b.val = test_table_bi(tests, &curr);
         b.positive = tests[curr++];
 
-        uint32_t e_words = tests[curr++];
-        sMPI expected = signed_init(e_words);
-        for (uint32_t j = 0; j < e_words; j++)
-            expected.val->data[j] = tests[curr++];
+        sMPI expected;
+        expected.val = test_table_bi(tests, &curr);
         expected.positive = tests[curr++];
 
         sMPI got = signed_add(a, b);
@@ -174,35 +165,21 @@ void test_signed_eucl_div(void) {
     };
     // clang-format on
 
-    size_t curr = 0;
+    uint32_t curr = 0;
     uint32_t test = 0;
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t a_words = tests[curr++];
-        sMPI a = signed_init(a_words);
-        for (uint32_t j = 0; j < a_words; j++)
-            a.val->data[j] = tests[curr++];
-        a.val->words = a_words;
+        sMPI a;
+        a.val = test_table_bi(tests, &curr);
         a.positive = tests[curr++] != 0u;
 
-        uint32_t b_words = tests[curr++];
-        sMPI b = signed_init(b_words);
-        for (uint32_t j = 0; j < b_words; j++)
-            b.val->data[j] = tests[curr++];
-        b.val->words = b_words;
+        sMPI b;
+        b.val = test_table_bi(tests, &curr);
         b.positive = tests[curr++] != 0u;
 
-        uint32_t q_words = tests[curr++];
-        MPI expected_q = bi_init(q_words);
-        for (uint32_t j = 0; j < q_words; j++)
-            expected_q->data[j] = tests[curr++];
-        expected_q->words = q_words;
+        MPI expected_q = test_table_bi(tests, &curr);
         bool expected_q_positive = tests[curr++] != 0u;
 
-        uint32_t r_words = tests[curr++];
-        MPI expected_remainder = bi_init(r_words);
-        for (uint32_t j = 0; j < r_words; j++)
-            expected_remainder->data[j] = tests[curr++];
-        expected_remainder->words = r_words;
+        MPI expected_remainder = test_table_bi(tests, &curr);
 
         sMPI q;
         MPI remainder = NULL;
@@ -41,11 +41,25 @@ void test_primality(void) {
     a->data[1] = 1;
     a->data[0] = 1;
     sd = miller_rabin_sd(a);
-    CU_ASSERT(bi_eq_val(sd.s, 32u));
+    CU_ASSERT(bi_eq_val(sd.s, BI_WORD_BITS));
     CU_ASSERT(bi_eq_val(sd.d, 1));
     bi_free(sd.s);
     bi_free(sd.d);
 
+    // witnesses stay in [2, n - 2], including when n's top word is 1 and
+    // there are no bits below its top bit to keep
+    MPI two = bi_init(1);
+    bi_set(two, 2u);
+    MPI n_minus_one = bi_init_and_copy(a);
+    bi_dec(n_minus_one);
+    for (uint32_t i = 0; i < 64; i++) {
+        MPI w = miller_rabin_randn(a);
+        CU_ASSERT(!bi_lt(w, two) && bi_lt(w, n_minus_one));
+        bi_free(w);
+    }
+    bi_free(two);
+    bi_free(n_minus_one);
+
     bi_free(a);
     a = bi_init(1);
     bi_set(a, 0xFFFFFFFB); // obviously prime
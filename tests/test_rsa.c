@@ -52,30 +52,15 @@ void test_calc_lambda_n_d(void) {
     uint32_t case_idx = 0;
 
     while (curr < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t p_words = tests[curr++];
-        MPI p = bi_init(p_words);
-        for (uint32_t j = 0; j < p_words; j++)
-            p->data[j] = tests[curr++];
-
-        uint32_t q_words = tests[curr++];
-        MPI q = bi_init(q_words);
-        for (uint32_t j = 0; j < q_words; j++)
-            q->data[j] = tests[curr++];
-
-        uint32_t e_words = tests[curr++];
-        MPI e = bi_init(e_words);
-        for (uint32_t j = 0; j < e_words; j++)
-            e->data[j] = tests[curr++];
-
-        uint32_t lambda_words = tests[curr++];
-        MPI expected_lambda = bi_init(lambda_words);
-        for (uint32_t j = 0; j < lambda_words; j++)
-            expected_lambda->data[j] = tests[curr++];
-
-        uint32_t d_words = tests[curr++];
-        MPI expected_d = bi_init(d_words);
-        for (uint32_t j = 0; j < d_words; j++)
-            expected_d->data[j] = tests[curr++];
+        MPI p = test_table_bi(tests, &curr);
+
+        MPI q = test_table_bi(tests, &curr);
+
+        MPI e = test_table_bi(tests, &curr);
+
+        MPI expected_lambda = test_table_bi(tests, &curr);
+
+        MPI expected_d = test_table_bi(tests, &curr);
 
         lambda_n_d_res_t res = calc_lambda_n_d(p, q, e);
 
@@ -137,50 +122,15 @@ void test_rsa_encrypt_decrypt_cases(void) {
     rsa_private_token_t priv;
 
     while (curr_pos < sizeof(tests) / sizeof(uint32_t)) {
-        uint32_t n_words = tests[curr_pos];
-        n = bi_init(n_words);
-        curr_pos++;
-
-        for (uint32_t i = 0; i < n_words; i++) {
-            n->data[i] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t e_words = tests[curr_pos];
-        e = bi_init(e_words);
-        curr_pos++;
+        n = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t i = 0; i < e_words; i++) {
-            e->data[i] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t d_words = tests[curr_pos];
-        d = bi_init(d_words);
-        curr_pos++;
+        e = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t i = 0; i < d_words; i++) {
-            d->data[i] = tests[curr_pos];
-            curr_pos++;
-        }
+        d = test_table_bi(tests, &curr_pos);
 
-        uint32_t m_words = tests[curr_pos];
-        m = bi_init(m_words);
-        curr_pos++;
+        m = test_table_bi(tests, &curr_pos);
 
-        for (uint32_t i = 0; i < m_words; i++) {
-            m->data[i] = tests[curr_pos];
-            curr_pos++;
-        }
-
-        uint32_t c_words = tests[curr_pos];
-        c = bi_init(c_words);
-        curr_pos++;
-
-        for (uint32_t i = 0; i < c_words; i++) {
-            c->data[i] = tests[curr_pos];
-            curr_pos++;
-        }
+        c = test_table_bi(tests, &curr_pos);
 
         pub.e = e;
         pub.n = bi_init_and_copy(n);
@@ -2,6 +2,8 @@
 #define TEST_SUITES_H
 
 #include <CUnit/CUnit.h>
+#include <bigint/bigint.h>
+#include <stdint.h>
 
 CU_pSuite register_bigint_tests(void);
 CU_pSuite register_bigint_signed_tests(void);
@@ -9,4 +11,12 @@ CU_pSuite register_crypto_core_tests(void);
 CU_pSuite register_rng_tests(void);
 CU_pSuite register_rsa_tests(void);
 
+// x from n 32 bit words, least significant first. The words are packed into
+// limbs, so tables of them hold for either limb width.
+MPI test_words_bi(const uint32_t *words, uint32_t n);
+
+// The next bigint in a test table, written as its count of 32 bit words and
+// then the words as for test_words_bi. Moves *pos past it.
+MPI test_table_bi(const uint32_t *table, uint32_t *pos);
+
 #endif
@@ -6,6 +6,26 @@
 
 #include "test_suites.h"
 
+MPI test_words_bi(const uint32_t *words, uint32_t n) {
+    uint32_t per_limb = BI_WORD_BITS / 32;
+    uint32_t limbs = n > 0 ? (n + per_limb - 1) / per_limb : 1;
+
+    MPI x = bi_init(limbs);
+    for (uint32_t i = 0; i < n; i++) {
+        x->data[i / per_limb] |= (bi_word_t)words[i] << (32 * (i % per_limb));
+    }
+
+    return x;
+}
+
+MPI test_table_bi(const uint32_t *table, uint32_t *pos) {
+    uint32_t n = table[(*pos)++];
+    MPI x = test_words_bi(table + *pos, n);
+    *pos += n;
+
+    return x;
+}
+
 int main(void) {
     if (CU_initialize_registry() != CUE_SUCCESS)
         return CU_get_error();
@@ -18,8 +38,9 @@ int main(void) {
     register_rsa_tests();
 
     CU_basic_run_tests();
+    unsigned int failures = CU_get_number_of_failures();
 
     CU_cleanup_registry();
 
-    return 0;
+    return failures == 0 ? 0 : 1;
 }